@@ -0,0 +1,69 @@
+/*
+
+Demonstrates sending the same packet every 250 milliseconds as a beacon.  The packet is loaded into the radio once,
+and each beacon is sent by pulsing the CE pin without any SPI communication.  The packet is only loaded again when
+the reading it contains changes.  Any receiver, e.g. the Basic_RX example, can receive the beacons.
+
+Radio    Arduino
+CE    -> 9
+CSN   -> 10 (Hardware SPI SS)
+MOSI  -> 11 (Hardware SPI MOSI)
+MISO  -> 12 (Hardware SPI MISO)
+SCK   -> 13 (Hardware SPI SCK)
+IRQ   -> No connection
+VCC   -> No more than 3.6 volts
+GND   -> GND
+
+*/
+
+#include "SPI.h"
+#include "NRFLite.h"
+
+const static uint8_t RADIO_ID = 1;
+const static uint8_t DESTINATION_RADIO_ID = 0;
+const static uint8_t PIN_RADIO_CE = 9;
+const static uint8_t PIN_RADIO_CSN = 10;
+
+struct BeaconPacket
+{
+    uint8_t FromRadioId;
+    uint16_t Reading;
+};
+
+NRFLite _radio;
+NRFLite::Beacon _beaconState;
+BeaconPacket _beacon;
+
+void setup()
+{
+    Serial.begin(115200);
+
+    if (!_radio.init(RADIO_ID, PIN_RADIO_CE, PIN_RADIO_CSN))
+    {
+        Serial.println("Cannot communicate with radio");
+        while (1); // Wait here forever.
+    }
+
+    _beacon.FromRadioId = RADIO_ID;
+    _beacon.Reading = analogRead(A0) >> 2 << 2;
+
+    // The beacon state and data must stay valid while beaconing, which is why they are global variables.
+    _radio.startBeacon(_beaconState, DESTINATION_RADIO_ID, &_beacon, sizeof(_beacon));
+}
+
+void loop()
+{
+    uint16_t reading = analogRead(A0) >> 2 << 2; // Ignore small changes so the packet is not reloaded every time.
+
+    if (reading != _beacon.Reading)
+    {
+        _beacon.Reading = reading;
+        _radio.updateBeacon(&_beacon, sizeof(_beacon));
+
+        Serial.print("Reading changed to ");
+        Serial.println(reading);
+    }
+
+    _radio.sendBeacon();
+    delay(250);
+}
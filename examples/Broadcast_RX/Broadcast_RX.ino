@@ -0,0 +1,88 @@
+/*
+
+Demonstrates receiving broadcasts sent to a group of radios, see the Broadcast_TX example.
+Each radio in the group needs a different RADIO_ID, which is also used to ask for the settings again
+if a broadcast is missed.
+
+Radio    Arduino
+CE    -> 9
+CSN   -> 10 (Hardware SPI SS)
+MOSI  -> 11 (Hardware SPI MOSI)
+MISO  -> 12 (Hardware SPI MISO)
+SCK   -> 13 (Hardware SPI SCK)
+IRQ   -> No connection
+VCC   -> No more than 3.6 volts
+GND   -> GND
+
+*/
+
+#include "SPI.h"
+#include "NRFLite.h"
+
+const static uint8_t RADIO_ID = 1;
+const static uint8_t BROADCASTER_RADIO_ID = 0;
+const static uint8_t GROUP_ID = 1;
+const static uint8_t PIN_RADIO_CE = 9;
+const static uint8_t PIN_RADIO_CSN = 10;
+
+struct SettingsPacket
+{
+    uint8_t Version;
+    uint16_t ReportIntervalSeconds;
+};
+
+struct RepairRequest
+{
+    uint8_t FromRadioId;
+};
+
+NRFLite _radio;
+uint32_t _lastSettingsTime;
+
+void setup()
+{
+    Serial.begin(115200);
+
+    _radio.listenForBroadcasts(GROUP_ID); // Must be called before 'init'.
+
+    if (!_radio.init(RADIO_ID, PIN_RADIO_CE, PIN_RADIO_CSN))
+    {
+        Serial.println("Cannot communicate with radio");
+        while (1); // Wait here forever.
+    }
+}
+
+void loop()
+{
+    uint8_t length = _radio.hasData();
+    if (length) _radio.discardData(length); // This example only uses broadcasts.
+
+    uint8_t data[NRFLite::MAX_BROADCAST_SIZE];
+    uint8_t sequence;
+
+    if (_radio.readBroadcast(data, sequence) == sizeof(SettingsPacket))
+    {
+        _lastSettingsTime = millis();
+
+        SettingsPacket settings;
+        memcpy(&settings, data, sizeof(settings));
+
+        Serial.print("Received settings version ");
+        Serial.print(settings.Version);
+        Serial.print(", report every ");
+        Serial.print(settings.ReportIntervalSeconds);
+        Serial.println(" seconds");
+
+        // Each broadcast has the next sequence number, so any gaps are broadcasts that were missed.
+        uint8_t newestSequence;
+        uint32_t missedBroadcasts = _radio.getMissedBroadcasts(newestSequence);
+        if (missedBroadcasts) Serial.println("Some earlier broadcasts were missed");
+    }
+    else if (millis() - _lastSettingsTime > 5999)
+    {
+        // Settings are broadcast every 5 seconds, so ask for them again if they didn't arrive.
+        _lastSettingsTime = millis();
+        RepairRequest request = { RADIO_ID };
+        _radio.send(BROADCASTER_RADIO_ID, &request, sizeof(request));
+    }
+}
@@ -0,0 +1,81 @@
+/*
+
+Demonstrates broadcasting a settings packet to every radio in a group at once, rather than sending it to each
+radio one at a time.  Radios that notice they missed a broadcast ask for it again, see the Broadcast_RX example.
+
+Radio    Arduino
+CE    -> 9
+CSN   -> 10 (Hardware SPI SS)
+MOSI  -> 11 (Hardware SPI MOSI)
+MISO  -> 12 (Hardware SPI MISO)
+SCK   -> 13 (Hardware SPI SCK)
+IRQ   -> No connection
+VCC   -> No more than 3.6 volts
+GND   -> GND
+
+*/
+
+#include "SPI.h"
+#include "NRFLite.h"
+
+const static uint8_t RADIO_ID = 0;
+const static uint8_t GROUP_ID = 1;
+const static uint8_t PIN_RADIO_CE = 9;
+const static uint8_t PIN_RADIO_CSN = 10;
+
+struct SettingsPacket
+{
+    uint8_t Version;
+    uint16_t ReportIntervalSeconds;
+};
+
+struct RepairRequest
+{
+    uint8_t FromRadioId;
+};
+
+NRFLite _radio;
+SettingsPacket _settings;
+uint8_t _settingsSequence;
+uint32_t _lastBroadcastTime;
+
+void setup()
+{
+    Serial.begin(115200);
+
+    if (!_radio.init(RADIO_ID, PIN_RADIO_CE, PIN_RADIO_CSN))
+    {
+        Serial.println("Cannot communicate with radio");
+        while (1); // Wait here forever.
+    }
+
+    _settings.ReportIntervalSeconds = 60;
+}
+
+void loop()
+{
+    if (millis() - _lastBroadcastTime > 4999)
+    {
+        _lastBroadcastTime = millis();
+        _settings.Version++;
+
+        // Each packet is sent 3 times, receivers keep the first copy and drop the rest.
+        _settingsSequence = _radio.broadcast(GROUP_ID, &_settings, sizeof(_settings), 3);
+
+        Serial.print("Broadcast settings version ");
+        Serial.println(_settings.Version);
+    }
+
+    while (_radio.hasData())
+    {
+        RepairRequest request;
+        _radio.readData(&request);
+
+        Serial.print("Radio ");
+        Serial.print(request.FromRadioId);
+        Serial.println(" missed the settings");
+
+        // Using the original sequence number means radios that already have the settings ignore it.
+        _radio.rebroadcast(GROUP_ID, _settingsSequence, &_settings, sizeof(_settings), 3);
+    }
+}
@@ -0,0 +1,102 @@
+/*
+
+Demonstrates queueing bursts of packets that are sent in the background using interrupts.  The queue holds more
+packets than the radio's 3 packet TX buffer, so 'enqueue' returns right away rather than waiting for the radio.
+
+Radio    Arduino
+CE    -> 9
+CSN   -> 10 (Hardware SPI SS)
+MOSI  -> 11 (Hardware SPI MOSI)
+MISO  -> 12 (Hardware SPI MISO)
+SCK   -> 13 (Hardware SPI SCK)
+IRQ   -> 3  (Hardware INT1)
+VCC   -> No more than 3.6 volts
+GND   -> GND
+
+*/
+
+#include "SPI.h"
+#include "NRFLite.h"
+
+const static uint8_t RADIO_ID = 1;
+const static uint8_t DESTINATION_RADIO_ID = 0;
+const static uint8_t PIN_RADIO_CE = 9;
+const static uint8_t PIN_RADIO_CSN = 10;
+const static uint8_t PIN_RADIO_IRQ = 3;
+const static uint8_t QUEUE_SIZE = 16;
+const static uint8_t BURST_SIZE = 10;
+
+NRFLite _radio;
+NRFLite::QueuedPacket _queue[QUEUE_SIZE]; // Each queued packet uses 36 bytes of memory.
+uint8_t _data;
+uint8_t _burstIndexes[BURST_SIZE];
+uint32_t _lastSendTime;
+volatile uint8_t _hadIrq; // Note usage of volatile since the variable is used in the radio
+                          // interrupt while also being used outside the interrupt.
+
+void radioInterrupt()
+{
+    _hadIrq = 1;
+}
+
+void setup()
+{
+    Serial.begin(115200);
+
+    if (!_radio.init(RADIO_ID, PIN_RADIO_CE, PIN_RADIO_CSN))
+    {
+        Serial.println("Cannot communicate with radio");
+        while (1); // Wait here forever.
+    }
+
+    _radio.startQueue(_queue, QUEUE_SIZE);
+
+    attachInterrupt(digitalPinToInterrupt(PIN_RADIO_IRQ), radioInterrupt, FALLING);
+}
+
+void loop()
+{
+    // Send a burst of packets once per second.
+    if (millis() - _lastSendTime > 999)
+    {
+        _lastSendTime = millis();
+
+        for (uint8_t i = 0; i < BURST_SIZE; i++)
+        {
+            _data++;
+
+            // The packet is copied into the queue, and its index is kept to check its status later.
+            _burstIndexes[i] = _radio.enqueue(DESTINATION_RADIO_ID, &_data, sizeof(_data));
+        }
+    }
+
+    // Let the radio library handle the interrupt.  It marks the packets that were sent or failed and
+    // loads the next ones into the radio.  This example doesn't use ACK data, but any that is received
+    // is removed so the radio's RX buffer never fills.
+    if (_hadIrq)
+    {
+        _hadIrq = 0;
+
+        if (_radio.serviceQueue())
+        {
+            uint8_t ackLength;
+            while ((ackLength = _radio.hasAckData())) _radio.discardData(ackLength);
+        }
+
+        if (_radio.getQueueCount() == 0)
+        {
+            uint8_t sentCount = 0;
+
+            for (uint8_t i = 0; i < BURST_SIZE; i++)
+            {
+                uint8_t index = _burstIndexes[i];
+                if (index != NRFLite::QUEUE_IS_FULL && _queue[index].Status == NRFLite::QUEUE_SENT) sentCount++;
+            }
+
+            Serial.print("Sent ");
+            Serial.print(sentCount);
+            Serial.print(" of ");
+            Serial.println(BURST_SIZE);
+        }
+    }
+}
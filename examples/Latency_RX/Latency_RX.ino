@@ -0,0 +1,86 @@
+/*
+
+Demonstrates measuring the one-way latency of packets sent by the Latency_TX example.  The time each packet was
+received is loaded as ACK data, so the transmitter can estimate the offset between the two radios' clocks and include
+it in its packets.  The one-way latency of each packet is added to a LatencyStats, which is printed every 100 packets.
+
+Radio    Arduino
+CE    -> 9
+CSN   -> 10 (Hardware SPI SS)
+MOSI  -> 11 (Hardware SPI MOSI)
+MISO  -> 12 (Hardware SPI MISO)
+SCK   -> 13 (Hardware SPI SCK)
+IRQ   -> No connection
+VCC   -> No more than 3.6 volts
+GND   -> GND
+
+*/
+
+#include "SPI.h"
+#include "NRFLite.h"
+
+const static uint8_t RADIO_ID = 0;
+const static uint8_t PIN_RADIO_CE = 9;
+const static uint8_t PIN_RADIO_CSN = 10;
+const static uint8_t SAMPLES_PER_PRINT = 100;
+
+struct RadioPacket
+{
+    uint32_t PacketId;
+    uint32_t SendMicros;
+    int32_t ClockOffset;
+    uint8_t HasClockOffset;
+};
+
+struct AckPacket
+{
+    uint32_t PacketId;
+    uint32_t RxMicros;
+};
+
+NRFLite _radio;
+NRFLite::Timestamps _timestamps;
+NRFLite::LatencyStats _oneWay;
+
+void setup()
+{
+    Serial.begin(115200);
+
+    if (!_radio.init(RADIO_ID, PIN_RADIO_CE, PIN_RADIO_CSN))
+    {
+        Serial.println("Cannot communicate with radio");
+        while (1); // Wait here forever.
+    }
+
+    _radio.setTimestamps(&_timestamps);
+}
+
+void loop()
+{
+    while (_radio.hasData())
+    {
+        RadioPacket radioData;
+        _radio.readData(&radioData);
+        uint32_t rxMicros = _timestamps.RxMicros;
+
+        // Replace any ACK data that was not sent, so the next ACK always describes this packet.
+        AckPacket ackData;
+        ackData.PacketId = radioData.PacketId;
+        ackData.RxMicros = rxMicros;
+        _radio.addAckData(&ackData, sizeof(ackData), 1);
+
+        if (radioData.HasClockOffset)
+        {
+            // The offset is an estimate, so skip the rare sample it makes negative.
+            int32_t latencyMicros = rxMicros - radioData.SendMicros - radioData.ClockOffset;
+            if (latencyMicros >= 0) NRFLite::addLatency(_oneWay, latencyMicros);
+        }
+
+        if (_oneWay.Count == SAMPLES_PER_PRINT)
+        {
+            Serial.println("One-way latency in microseconds");
+            NRFLite::printLatency(Serial, _oneWay);
+            _oneWay = {};
+        }
+    }
+}
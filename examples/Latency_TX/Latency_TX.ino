@@ -0,0 +1,97 @@
+/*
+
+Demonstrates measuring latency using the timestamps recorded by the library.  Packets are sent every 50 milliseconds,
+and the round-trip time of each packet and its ACK is added to a LatencyStats, which is printed every 100 packets.
+
+The Latency_RX example loads the time it received each packet as ACK data, which comes back with the ACK of the next
+packet.  From that time and the send and ACK times of the packet, the offset between the two radios' clocks is
+estimated and included in the next packet, so the receiver can measure the one-way latency of each packet.
+
+Radio    Arduino
+CE    -> 9
+CSN   -> 10 (Hardware SPI SS)
+MOSI  -> 11 (Hardware SPI MOSI)
+MISO  -> 12 (Hardware SPI MISO)
+SCK   -> 13 (Hardware SPI SCK)
+IRQ   -> No connection
+VCC   -> No more than 3.6 volts
+GND   -> GND
+
+*/
+
+#include "SPI.h"
+#include "NRFLite.h"
+
+const static uint8_t RADIO_ID = 1;
+const static uint8_t DESTINATION_RADIO_ID = 0;
+const static uint8_t PIN_RADIO_CE = 9;
+const static uint8_t PIN_RADIO_CSN = 10;
+const static uint8_t SAMPLES_PER_PRINT = 100;
+
+struct RadioPacket
+{
+    uint32_t PacketId;
+    uint32_t SendMicros;
+    int32_t ClockOffset;     // How far the receiver's clock is ahead of the transmitter's.
+    uint8_t HasClockOffset;
+};
+
+struct AckPacket
+{
+    uint32_t PacketId;
+    uint32_t RxMicros;       // Time the receiver received the packet, using its clock.
+};
+
+NRFLite _radio;
+NRFLite::Timestamps _timestamps;
+NRFLite::LatencyStats _roundTrip;
+RadioPacket _radioData;
+uint32_t _lastSendMicros, _lastAckMicros;
+
+void setup()
+{
+    Serial.begin(115200);
+
+    if (!_radio.init(RADIO_ID, PIN_RADIO_CE, PIN_RADIO_CSN))
+    {
+        Serial.println("Cannot communicate with radio");
+        while (1); // Wait here forever.
+    }
+
+    _radio.setTimestamps(&_timestamps);
+}
+
+void loop()
+{
+    _radioData.PacketId++;
+    _radioData.SendMicros = micros();
+
+    if (_radio.send(DESTINATION_RADIO_ID, &_radioData, sizeof(_radioData)))
+    {
+        while (_radio.hasAckData())
+        {
+            AckPacket ackData;
+            _radio.readData(&ackData);
+
+            // The ACK data describes the previous packet, whose send and ACK times were saved.
+            if (ackData.PacketId == _radioData.PacketId - 1)
+            {
+                _radioData.ClockOffset = NRFLite::getClockOffset(_lastSendMicros, ackData.RxMicros, _lastAckMicros);
+                _radioData.HasClockOffset = 1;
+            }
+        }
+
+        _lastSendMicros = _timestamps.TxStartMicros;
+        _lastAckMicros = _timestamps.TxDoneMicros;
+        NRFLite::addLatency(_roundTrip, _lastAckMicros - _lastSendMicros);
+
+        if (_roundTrip.Count == SAMPLES_PER_PRINT)
+        {
+            Serial.println("Round-trip latency in microseconds");
+            NRFLite::printLatency(Serial, _roundTrip);
+            _roundTrip = {};
+        }
+    }
+
+    delay(50);
+}
@@ -0,0 +1,58 @@
+/*
+
+Demonstrates recording the SPI communication between the library and the radio.
+Every 10 sends the trace is printed, save the serial output to a file and decode it with extras/trace_analyzer.py
+to see how long mode changes, sends, and retries took.
+
+Radio    Arduino
+CE    -> 9
+CSN   -> 10 (Hardware SPI SS)
+MOSI  -> 11 (Hardware SPI MOSI)
+MISO  -> 12 (Hardware SPI MISO)
+SCK   -> 13 (Hardware SPI SCK)
+IRQ   -> No connection
+VCC   -> No more than 3.6 volts
+GND   -> GND
+
+*/
+
+#include "SPI.h"
+#include "NRFLite.h"
+
+const static uint8_t RADIO_ID = 1;
+const static uint8_t DESTINATION_RADIO_ID = 0;
+const static uint8_t PIN_RADIO_CE = 9;
+const static uint8_t PIN_RADIO_CSN = 10;
+
+NRFLite _radio;
+NRFLite::TraceEntry _trace[64]; // Each entry uses 8 bytes of RAM.
+uint8_t _data;
+
+void setup()
+{
+    Serial.begin(115200);
+
+    if (!_radio.init(RADIO_ID, PIN_RADIO_CE, PIN_RADIO_CSN))
+    {
+        Serial.println("Cannot communicate with radio");
+        while (1); // Wait here forever.
+    }
+
+    _radio.startTrace(_trace, sizeof(_trace) / sizeof(_trace[0]));
+}
+
+void loop()
+{
+    _data++;
+    _radio.send(DESTINATION_RADIO_ID, &_data, sizeof(_data));
+
+    if (_data % 10 == 0)
+    {
+        // Stop tracing while printing so the trace only contains the sends.
+        _radio.stopTrace();
+        _radio.printTrace(Serial);
+        _radio.startTrace(_trace, sizeof(_trace) / sizeof(_trace[0]));
+    }
+
+    delay(100);
+}
@@ -0,0 +1,81 @@
+/*
+
+Demonstrates receiving packets of different types using typed messages.
+Each message type has its own handler function, so there's no need to check the packet length.
+
+Radio    Arduino
+CE    -> 9
+CSN   -> 10 (Hardware SPI SS)
+MOSI  -> 11 (Hardware SPI MOSI)
+MISO  -> 12 (Hardware SPI MISO)
+SCK   -> 13 (Hardware SPI SCK)
+IRQ   -> No connection
+VCC   -> No more than 3.6 volts
+GND   -> GND
+
+*/
+
+#include "SPI.h"
+#include "NRFLite.h"
+
+const static uint8_t RADIO_ID = 0;
+const static uint8_t PIN_RADIO_CE = 9;
+const static uint8_t PIN_RADIO_CSN = 10;
+
+struct CounterMessage
+{
+    static const uint8_t MESSAGE_ID = 0;
+    uint8_t FromRadioId;
+    uint8_t Counter;
+};
+
+struct TextMessage
+{
+    static const uint8_t MESSAGE_ID = 1;
+    uint8_t FromRadioId;
+    char Message[30];
+};
+
+NRFLite _radio;
+NRFLite::MessageRoute _messageRoutes[2]; // One for each message id, 0 and 1.
+
+void handleCounterMessage(CounterMessage &message)
+{
+    Serial.print("Received ");
+    Serial.print(message.Counter);
+    Serial.print(" from radio ");
+    Serial.println(message.FromRadioId);
+}
+
+void handleTextMessage(TextMessage &message)
+{
+    message.Message[sizeof(message.Message) - 1] = 0; // Ensure the string is terminated.
+
+    Serial.print("Received '");
+    Serial.print(message.Message);
+    Serial.print("' from radio ");
+    Serial.println(message.FromRadioId);
+}
+
+void setup()
+{
+    Serial.begin(115200);
+
+    if (!_radio.init(RADIO_ID, PIN_RADIO_CE, PIN_RADIO_CSN))
+    {
+        Serial.println("Cannot communicate with radio");
+        while (1); // Wait here forever.
+    }
+
+    // Register a handler for each message type.
+    _radio.startMessages(_messageRoutes, 2);
+    _radio.on(handleCounterMessage);
+    _radio.on(handleTextMessage);
+}
+
+void loop()
+{
+    // 'dispatchMessage' reads each received message into the correct type and calls its handler.
+    // Messages without a handler or with an unexpected size are removed from the radio.
+    while (_radio.dispatchMessage());
+}
@@ -0,0 +1,97 @@
+/*
+
+Demonstrates sending packets of different types using typed messages.
+Each message type is tagged with its MESSAGE_ID so the receiver does not need to rely on the packet length.
+
+Radio    Arduino
+CE    -> 9
+CSN   -> 10 (Hardware SPI SS)
+MOSI  -> 11 (Hardware SPI MOSI)
+MISO  -> 12 (Hardware SPI MISO)
+SCK   -> 13 (Hardware SPI SCK)
+IRQ   -> No connection
+VCC   -> No more than 3.6 volts
+GND   -> GND
+
+*/
+
+#include "SPI.h"
+#include "NRFLite.h"
+
+const static uint8_t RADIO_ID = 1;
+const static uint8_t DESTINATION_RADIO_ID = 0;
+const static uint8_t PIN_RADIO_CE = 9;
+const static uint8_t PIN_RADIO_CSN = 10;
+
+struct CounterMessage
+{
+    static const uint8_t MESSAGE_ID = 0;
+    uint8_t FromRadioId;
+    uint8_t Counter;
+};
+
+struct TextMessage
+{
+    static const uint8_t MESSAGE_ID = 1;
+    uint8_t FromRadioId;
+    char Message[30];    // Note the max message size is 31, so 30 is all we can use here.
+};
+
+NRFLite _radio;
+CounterMessage _counterMessage;
+TextMessage _textMessage;
+
+void setup()
+{
+    Serial.begin(115200);
+
+    if (!_radio.init(RADIO_ID, PIN_RADIO_CE, PIN_RADIO_CSN))
+    {
+        Serial.println("Cannot communicate with radio");
+        while (1); // Wait here forever.
+    }
+
+    _counterMessage.FromRadioId = RADIO_ID;
+    _textMessage.FromRadioId = RADIO_ID;
+}
+
+void loop()
+{
+    // Pick a number from 0 - 60,000.
+    uint16_t randomNumber = random(60001);
+
+    uint8_t success;
+
+    if (randomNumber > 30000)
+    {
+        _counterMessage.Counter++;
+
+        Serial.print("Sending ");
+        Serial.print(_counterMessage.Counter);
+
+        // The message type determines the packet size and id, and a message type that
+        // is too large to fit in a packet will not compile.
+        success = _radio.send(DESTINATION_RADIO_ID, _counterMessage);
+    }
+    else
+    {
+        snprintf(_textMessage.Message, sizeof(_textMessage.Message), "Hello %u", randomNumber);
+
+        Serial.print("Sending '");
+        Serial.print(_textMessage.Message);
+        Serial.print("'");
+
+        success = _radio.send(DESTINATION_RADIO_ID, _textMessage);
+    }
+
+    if (success)
+    {
+        Serial.println("...Success");
+    }
+    else
+    {
+        Serial.println("...Failed");
+    }
+
+    delay(1000);
+}
@@ -0,0 +1,648 @@
+// Benchmarks throughput, latency, and delivery of many NRFLite transmitters sending to one receiver.
+//
+// Every transmitter sends packets containing its radio id, a sequence number, and the time the packet was created.
+// The receiver, radio id 0, counts each unique packet once and measures its one-way latency using the shared
+// simulation clock.  Run with --help to see the options.
+//
+// With --update, radio id 0 instead pushes an update of the given size to every other radio, either with ACKed
+// sends to each radio, with batches of ACKed sends, or with broadcasts followed by repair rounds, and measures how
+// long it takes.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <math.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "NRFLite.h"
+#include "Simulator.h"
+
+using sim::Node;
+using sim::Simulator;
+
+enum Strategies { STRATEGY_SEND, STRATEGY_NO_ACK, STRATEGY_START_SEND, STRATEGY_BEACON, STRATEGY_QUEUE };
+static const char *STRATEGY_NAMES[] = { "send", "noack", "startsend", "beacon", "queue" };
+
+static const uint16_t BEACON_UPDATE_INTERVAL = 10; // Beacons change their data every this many packets.
+static const uint8_t TX_QUEUE_SIZE = 16;
+static const uint8_t AUTO_POWER_DESTINATIONS = 4;
+
+struct Settings
+{
+    std::vector<uint32_t> NodeCounts;
+    std::vector<Strategies> StrategyList;
+    NRFLite::Bitrates Bitrate;
+    NRFLite::AddressWidths AddressWidth;
+    NRFLite::CrcLengths CrcLength;
+    uint8_t PayloadLength, StaticPayloads, LossPercent, SharedPins, AdaptiveRxWindow, AutoPower, ListenBeforeTalk, Timestamps;
+    uint32_t IntervalMicros, Seconds, Seed, UpdateBytes, BurstSize;
+    uint8_t BroadcastCopies;
+    double RadiusMeters;
+};
+
+struct BenchmarkPacket
+{
+    uint8_t FromRadioId;
+    uint16_t Sequence;
+    uint32_t CreatedMicros;
+} __attribute__((packed));
+
+struct Results
+{
+    uint32_t Offered, SenderSuccesses, SenderFailures, Delivered, Duplicates;
+    uint64_t SendMicros; // Time the transmitters spent in send calls.
+    std::vector<uint32_t> Latencies;
+    std::vector<std::vector<uint8_t> > Seen; // Sequence numbers received from each transmitter.
+};
+
+// Random times that keep the nodes from running in step.  They come from the simulator since 'random' returns the
+// same numbers on every node.
+static uint32_t randomMicros(uint32_t howBig)
+{
+    return Simulator::Active->rng()() % howBig;
+}
+
+static void runReceiver(Node &node, const Settings &settings, Results &results)
+{
+    NRFLite &radio = *node.Lib;
+    radio.setPacketFormat(settings.AddressWidth, settings.CrcLength, settings.StaticPayloads ? settings.PayloadLength : 0);
+    NRFLite::Timestamps timestamps;
+    radio.setTimestamps(settings.Timestamps ? &timestamps : NULL);
+    radio.init(0, node.CePin, node.CsnPin, settings.Bitrate);
+    radio.setAdaptiveRxWindow(settings.AdaptiveRxWindow);
+
+    uint8_t data[32];
+
+    while (1)
+    {
+        uint8_t length = radio.hasData();
+
+        if (length == 0)
+        {
+            if (settings.SharedPins) delayMicroseconds(radio.microsUntilRxCheck() + 10); // hasData rate-limits itself in this mode.
+            continue;
+        }
+
+        radio.readData(data);
+
+        BenchmarkPacket packet;
+        memcpy(&packet, data, sizeof(packet));
+        if (length < sizeof(packet) || packet.FromRadioId >= results.Seen.size()) continue;
+
+        std::vector<uint8_t> &seen = results.Seen[packet.FromRadioId];
+        if (packet.Sequence >= seen.size()) seen.resize(packet.Sequence + 1);
+
+        if (seen[packet.Sequence])
+        {
+            results.Duplicates++;
+        }
+        else
+        {
+            seen[packet.Sequence] = 1;
+            results.Delivered++;
+            uint32_t receivedMicros = settings.Timestamps ? timestamps.RxMicros : micros();
+            results.Latencies.push_back(receivedMicros - packet.CreatedMicros);
+        }
+    }
+}
+
+static void runTransmitter(Node &node, uint8_t radioId, Strategies strategy, const Settings &settings, Results &results)
+{
+    NRFLite &radio = *node.Lib;
+    radio.setPacketFormat(settings.AddressWidth, settings.CrcLength, settings.StaticPayloads ? settings.PayloadLength : 0);
+    NRFLite::PowerEntry powerEntries[AUTO_POWER_DESTINATIONS];
+    radio.setAutoPower(powerEntries, settings.AutoPower ? AUTO_POWER_DESTINATIONS : 0);
+    radio.setListenBeforeTalk(settings.ListenBeforeTalk);
+    NRFLite::Timestamps timestamps;
+    radio.setTimestamps(settings.Timestamps ? &timestamps : NULL);
+    radio.init(radioId, node.CePin, node.CsnPin, settings.Bitrate);
+
+    NRFLite::QueuedPacket queue[TX_QUEUE_SIZE];
+    if (strategy == STRATEGY_QUEUE) radio.startQueue(queue, TX_QUEUE_SIZE);
+
+    // Start at a random time so the transmitters are not synchronized.
+    delayMicroseconds(randomMicros(settings.IntervalMicros + 1000));
+
+    uint8_t data[32] = { 0 };
+    BenchmarkPacket packet = { radioId, 0, 0 };
+    NRFLite::Beacon beacon;
+
+    while (1)
+    {
+        uint32_t startMicros = micros();
+
+        if (strategy == STRATEGY_BEACON)
+        {
+            results.Offered++;
+
+            // Every copy of a beacon counts as delivered, and only the first copy of new data measures latency.
+            if (packet.Sequence % BEACON_UPDATE_INTERVAL == 0)
+            {
+                packet.CreatedMicros = startMicros;
+                memcpy(data, &packet, sizeof(packet));
+                if (packet.Sequence == 0) radio.startBeacon(beacon, 0, data, settings.PayloadLength);
+                else radio.updateBeacon(data, settings.PayloadLength);
+            }
+
+            radio.sendBeacon();
+            packet.Sequence++;
+            delayMicroseconds(settings.IntervalMicros * 3 / 4 + randomMicros(settings.IntervalMicros / 2 + 1));
+            continue;
+        }
+
+        // Every packet in a burst is created at the same time, so latency includes waiting for the earlier ones.
+        for (uint32_t i = 0; i < settings.BurstSize; i++)
+        {
+            packet.CreatedMicros = startMicros;
+            memcpy(data, &packet, sizeof(packet));
+            results.Offered++;
+
+            uint32_t sendStartMicros = micros();
+
+            if (strategy == STRATEGY_START_SEND)
+            {
+                radio.startSend(0, data, settings.PayloadLength);
+            }
+            else if (strategy == STRATEGY_QUEUE)
+            {
+                while (radio.enqueue(0, data, settings.PayloadLength) == NRFLite::QUEUE_IS_FULL)
+                {
+                    if (node.Chip.irqIsActive()) radio.serviceQueue();
+                    else delayMicroseconds(10);
+                }
+            }
+            else
+            {
+                NRFLite::SendType sendType = strategy == STRATEGY_NO_ACK ? NRFLite::NO_ACK : NRFLite::REQUIRE_ACK;
+                if (radio.send(0, data, settings.PayloadLength, sendType)) results.SenderSuccesses++;
+                else results.SenderFailures++;
+            }
+
+            results.SendMicros += micros() - sendStartMicros;
+            packet.Sequence++;
+        }
+
+        // Wait for the next send with +/- 25% jitter, servicing interrupts when using startSend or the queue.
+        // An interval of 0 sends as fast as possible.
+        uint32_t interval = settings.IntervalMicros * 3 / 4 + randomMicros(settings.IntervalMicros / 2 + 1);
+
+        do
+        {
+            if (strategy == STRATEGY_START_SEND && node.Chip.irqIsActive())
+            {
+                uint8_t txOk, txFail, rxReady;
+                radio.whatHappened(txOk, txFail, rxReady);
+                results.SenderSuccesses += txOk;
+                results.SenderFailures += txFail;
+            }
+            else if (strategy == STRATEGY_QUEUE && node.Chip.irqIsActive())
+            {
+                radio.serviceQueue();
+            }
+            else if (interval)
+            {
+                delayMicroseconds(50);
+            }
+        } while (micros() - startMicros < interval);
+    }
+}
+
+enum UpdateStrategies { UPDATE_UNICAST, UPDATE_BROADCAST, UPDATE_ROUND_ROBIN, UPDATE_BATCH };
+static const char *UPDATE_STRATEGY_NAMES[] = { "unicast", "broadcast", "roundrobin", "batch" };
+
+static const uint8_t UPDATE_GROUP_ID = 1;
+static const uint8_t UPDATE_FRAGMENT_SIZE = 28;
+static const uint32_t REPAIR_WAIT_MICROS = 20000; // Time without new fragments before a radio asks for missing ones.
+
+struct UpdateFragment
+{
+    uint8_t Index, Count;
+    uint8_t Data[UPDATE_FRAGMENT_SIZE];
+};
+
+struct RepairRequest
+{
+    uint8_t FromRadioId;
+    uint32_t MissingFragments; // Bit n is set if fragment n is missing.
+} __attribute__((packed));
+
+struct UpdateResults
+{
+    std::vector<uint32_t> MissingFragments; // For each radio.
+    uint32_t StartMicros, CompletedCount, CompletedMicros, RepairRequests, Rebroadcasts;
+};
+
+static void runUpdateSender(Node &node, UpdateStrategies strategy, uint32_t nodeCount, const Settings &settings, UpdateResults &results)
+{
+    NRFLite &radio = *node.Lib;
+    radio.setPacketFormat(settings.AddressWidth, settings.CrcLength);
+    radio.init(0, node.CePin, node.CsnPin, settings.Bitrate);
+    delay(10); // Let the receivers start listening.
+    results.StartMicros = micros();
+
+    uint8_t count = (settings.UpdateBytes + UPDATE_FRAGMENT_SIZE - 1) / UPDATE_FRAGMENT_SIZE;
+    std::vector<UpdateFragment> fragments(count);
+    std::vector<uint8_t> sequences(count);
+    for (uint8_t f = 0; f < count; f++) { fragments[f].Index = f; fragments[f].Count = count; }
+
+    if (strategy == UPDATE_UNICAST)
+    {
+        for (uint32_t radioId = 1; radioId <= nodeCount; radioId++)
+        {
+            for (uint8_t f = 0; f < count; f++)
+            {
+                while (!radio.send(radioId, &fragments[f], sizeof(UpdateFragment))) {} // Retry until it is received.
+            }
+        }
+
+        while (1) delay(1000);
+    }
+
+    if (strategy == UPDATE_ROUND_ROBIN)
+    {
+        // Like a gateway polling every radio in turn, so the destination changes with every packet.
+        for (uint8_t f = 0; f < count; f++)
+        {
+            for (uint32_t radioId = 1; radioId <= nodeCount; radioId++)
+            {
+                while (!radio.send(radioId, &fragments[f], sizeof(UpdateFragment))) {}
+            }
+        }
+
+        while (1) delay(1000);
+    }
+
+    if (strategy == UPDATE_BATCH)
+    {
+        // The same round robin order, which 'sendBatch' groups by destination.  Failed items are sent again.
+        std::vector<NRFLite::BatchItem> pending;
+
+        for (uint8_t f = 0; f < count; f++)
+        {
+            for (uint32_t radioId = 1; radioId <= nodeCount; radioId++)
+            {
+                NRFLite::BatchItem item = { (uint8_t)radioId, &fragments[f], sizeof(UpdateFragment), NRFLite::QUEUE_WAITING };
+                pending.push_back(item);
+            }
+        }
+
+        while (!pending.empty())
+        {
+            uint8_t itemCount = std::min(pending.size(), (size_t)255);
+            radio.sendBatch(&pending[0], itemCount);
+
+            std::vector<NRFLite::BatchItem> failed;
+            for (uint8_t i = 0; i < itemCount; i++) if (pending[i].Status != NRFLite::QUEUE_SENT) failed.push_back(pending[i]);
+            failed.insert(failed.end(), pending.begin() + itemCount, pending.end());
+            pending.swap(failed);
+        }
+
+        while (1) delay(1000);
+    }
+
+    for (uint8_t f = 0; f < count; f++)
+    {
+        sequences[f] = radio.broadcast(UPDATE_GROUP_ID, &fragments[f], sizeof(UpdateFragment), settings.BroadcastCopies);
+    }
+
+    // Repair rounds, rebroadcast every fragment any radio asked for.
+    while (1)
+    {
+        uint32_t missing = 0;
+        uint32_t startMicros = micros();
+
+        while (micros() - startMicros < REPAIR_WAIT_MICROS * 2)
+        {
+            RepairRequest request;
+            if (radio.hasData() == sizeof(request))
+            {
+                radio.readData(&request);
+                missing |= request.MissingFragments;
+                results.RepairRequests++;
+            }
+            else
+            {
+                delayMicroseconds(100);
+            }
+        }
+
+        for (uint8_t f = 0; f < count; f++)
+        {
+            if (missing & ((uint32_t)1 << f))
+            {
+                radio.rebroadcast(UPDATE_GROUP_ID, sequences[f], &fragments[f], sizeof(UpdateFragment), settings.BroadcastCopies);
+                results.Rebroadcasts++;
+            }
+        }
+    }
+}
+
+static void runUpdateReceiver(Node &node, uint8_t radioId, UpdateStrategies strategy, const Settings &settings, UpdateResults &results)
+{
+    NRFLite &radio = *node.Lib;
+    radio.setPacketFormat(settings.AddressWidth, settings.CrcLength);
+    radio.listenForBroadcasts(UPDATE_GROUP_ID);
+    radio.init(radioId, node.CePin, node.CsnPin, settings.Bitrate);
+
+    uint32_t &missing = results.MissingFragments[radioId];
+    uint8_t hasCount = 0;
+    uint32_t lastFragmentMicros = micros();
+
+    while (1)
+    {
+        UpdateFragment fragment;
+        uint8_t sequence;
+        uint8_t length = radio.hasData();
+
+        if (length == sizeof(fragment)) radio.readData(&fragment);
+        else if (length) radio.discardData(length);
+        else length = radio.readBroadcast(&fragment, sequence);
+
+        if (length == sizeof(fragment))
+        {
+            if (!hasCount) { missing = fragment.Count < 32 ? ((uint32_t)1 << fragment.Count) - 1 : 0xFFFFFFFF; hasCount = 1; }
+
+            uint32_t bit = (uint32_t)1 << fragment.Index;
+            if (missing & bit)
+            {
+                missing &= ~bit;
+                lastFragmentMicros = micros();
+
+                if (!missing)
+                {
+                    results.CompletedCount++;
+                    results.CompletedMicros = micros();
+                }
+            }
+        }
+        else if (strategy == UPDATE_BROADCAST && hasCount && missing && micros() - lastFragmentMicros > REPAIR_WAIT_MICROS)
+        {
+            // Ask for the missing fragments, waiting a random time so requests from different radios don't collide.
+            delayMicroseconds(randomMicros(5000));
+            RepairRequest request = { radioId, missing };
+            radio.send(0, &request, sizeof(request));
+            lastFragmentMicros = micros();
+        }
+        else
+        {
+            delayMicroseconds(100);
+        }
+    }
+}
+
+static void runUpdateScenario(uint32_t nodeCount, UpdateStrategies strategy, const Settings &settings)
+{
+    Simulator simulator(settings.Seed, settings.LossPercent);
+    UpdateResults results = UpdateResults();
+    results.MissingFragments.resize(nodeCount + 1);
+
+    uint8_t csnPin = 10;
+    uint8_t cePin = settings.SharedPins ? csnPin : 9;
+
+    simulator.addNode([&](Node &node) { runUpdateSender(node, strategy, nodeCount, settings, results); }, cePin, csnPin);
+
+    for (uint32_t i = 1; i <= nodeCount; i++)
+    {
+        simulator.addNode([&, i](Node &node) { runUpdateReceiver(node, i, strategy, settings, results); }, cePin, csnPin);
+    }
+
+    // Run in small steps so the simulation stops soon after every radio has the update.
+    static const uint32_t STEP_MICROS = 10000;
+    uint64_t endMicros = (uint64_t)settings.Seconds * 1000000;
+    for (uint64_t t = 0; t < endMicros && results.CompletedCount < nodeCount; t += STEP_MICROS) simulator.run(STEP_MICROS);
+
+    uint32_t packets = simulator.nodes()[0]->Chip.Stats.Transmissions;
+    double airtime = simulator.nodes()[0]->Chip.Stats.AirtimeNanos / 1000000.0;
+
+    printf("%-10s %5u %8u %8u %10.1f %8u %9.1f %8u %8u %8u\n",
+           UPDATE_STRATEGY_NAMES[strategy], nodeCount, settings.UpdateBytes, results.CompletedCount,
+           results.CompletedCount == nodeCount ? (results.CompletedMicros - results.StartMicros) / 1000.0 : -1.0,
+           packets, airtime, results.RepairRequests, results.Rebroadcasts, simulator.nodes()[0]->Chip.Stats.SpiTransactions);
+}
+
+static void runScenario(uint32_t nodeCount, Strategies strategy, const Settings &settings)
+{
+    Simulator simulator(settings.Seed, settings.LossPercent);
+    Results results = Results();
+    results.Seen.resize(nodeCount + 1);
+
+    uint8_t csnPin = 10;
+    uint8_t cePin = settings.SharedPins ? csnPin : 9;
+
+    simulator.addNode([&](Node &node) { runReceiver(node, settings, results); }, cePin, csnPin);
+
+    // Transmitters are spread evenly over a circle around the receiver.
+    std::mt19937 placement(settings.Seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    for (uint32_t i = 1; i <= nodeCount; i++)
+    {
+        Node &node = simulator.addNode([&, i](Node &node) { runTransmitter(node, i, strategy, settings, results); }, cePin, csnPin);
+        double distance = settings.RadiusMeters * sqrt(uniform(placement));
+        double angle = 2 * M_PI * uniform(placement);
+        node.X = distance * cos(angle);
+        node.Y = distance * sin(angle);
+    }
+
+    // Let every radio finish initializing before measuring.
+    static const uint32_t STARTUP_MICROS = 200000;
+    simulator.run(STARTUP_MICROS);
+    results = Results();
+    results.Seen.resize(nodeCount + 1);
+    for (size_t i = 0; i < simulator.nodes().size(); i++) simulator.nodes()[i]->Chip.Stats = sim::RadioStats();
+    simulator.Stats = sim::MediumStats();
+
+    uint64_t durationMicros = (uint64_t)settings.Seconds * 1000000;
+    simulator.run(durationMicros);
+
+    // Packets created during startup may arrive during the measurement, only count what was offered in it.
+    uint32_t received = strategy == STRATEGY_BEACON ? results.Delivered + results.Duplicates : results.Delivered;
+    uint32_t delivered = std::min(received, results.Offered);
+    double seconds = settings.Seconds;
+    uint32_t retransmissions = 0;
+    for (size_t i = 0; i < simulator.nodes().size(); i++) retransmissions += simulator.nodes()[i]->Chip.Stats.Retransmissions;
+    double transmitterEnergy = 0;
+    for (size_t i = 1; i < simulator.nodes().size(); i++) transmitterEnergy += simulator.nodes()[i]->Chip.Stats.EnergyMicrojoules;
+
+    std::vector<uint32_t> &latencies = results.Latencies;
+    std::sort(latencies.begin(), latencies.end());
+    double averageLatency = 0;
+    for (size_t i = 0; i < latencies.size(); i++) averageLatency += latencies[i];
+    if (!latencies.empty()) averageLatency /= latencies.size();
+    uint32_t p95Latency = latencies.empty() ? 0 : latencies[latencies.size() * 95 / 100];
+    uint32_t maxLatency = latencies.empty() ? 0 : latencies.back();
+
+    uint32_t transmitterSpiTransactions = 0;
+    for (size_t i = 1; i < simulator.nodes().size(); i++) transmitterSpiTransactions += simulator.nodes()[i]->Chip.Stats.SpiTransactions;
+
+    printf("%-10s %5u %8u %8u %7.1f%% %9.1f %10.0f %9.2f %9.2f %9.2f %8u %8u %8.1f %8.0f %9.2f %8.0f\n",
+           STRATEGY_NAMES[strategy], nodeCount, results.Offered, delivered,
+           results.Offered ? 100.0 * delivered / results.Offered : 0.0,
+           delivered / seconds, delivered * settings.PayloadLength / seconds,
+           averageLatency / 1000, p95Latency / 1000.0, maxLatency / 1000.0,
+           simulator.Stats.Collisions, retransmissions, delivered ? transmitterEnergy / delivered : 0.0,
+           simulator.nodes()[0]->Chip.Stats.SpiTransactions / seconds,
+           results.Offered ? (double)transmitterSpiTransactions / results.Offered : 0.0,
+           results.Offered ? (double)results.SendMicros / results.Offered : 0.0);
+}
+
+static void printUsage()
+{
+    printf("Usage: nrflite_benchmark [options]\n"
+           "  --nodes 1,5,10,20,50      transmitter counts to simulate\n"
+           "  --strategy all            send, noack, startsend, beacon, queue, a comma separated list, or all\n"
+           "  --bitrate 2m              2m, 1m, or 250k\n"
+           "  --payload 8               payload length in bytes, 7 to 32\n"
+           "  --interval 20             milliseconds between packets from each transmitter, 0 to send continuously\n"
+           "  --burst 1                 packets created together every interval\n"
+           "  --address-width 5         address width in bytes, 3 to 5\n"
+           "  --crc 1                   CRC length in bytes, 1 or 2\n"
+           "  --static                  use static payloads of the --payload length\n"
+           "  --loss 0                  random packet loss percentage\n"
+           "  --seconds 10              simulated time for each scenario\n"
+           "  --shared-pins             use shared CE and CSN pin operation\n"
+           "  --adaptive-rx             adapt the receiver's shared pin RX window to the traffic\n"
+           "  --radius 0                meters, transmitters are placed randomly within this distance of the receiver\n"
+           "  --auto-power              enable automatic transmit power control on the transmitters\n"
+           "  --lbt                     enable listen-before-talk on the transmitters\n"
+           "  --timestamps              enable timestamps, latency is measured to the time radio 0 found each packet\n"
+           "  --seed 1                  random seed\n"
+           "  --update 512              push an update of this many bytes, up to 896, from radio 0 to every other radio\n"
+           "                            using the unicast, roundrobin, batch, or broadcast strategies\n"
+           "  --copies 2                copies of each broadcast packet\n");
+}
+
+static std::vector<uint32_t> parseList(const char *text)
+{
+    std::vector<uint32_t> values;
+    std::string list(text);
+    size_t start = 0;
+
+    while (start < list.size())
+    {
+        size_t comma = list.find(',', start);
+        if (comma == std::string::npos) comma = list.size();
+        values.push_back(strtoul(list.substr(start, comma - start).c_str(), NULL, 10));
+        start = comma + 1;
+    }
+
+    return values;
+}
+
+int main(int argc, char *argv[])
+{
+    Settings settings;
+    settings.NodeCounts = parseList("1,5,10,20,50");
+    settings.Bitrate = NRFLite::BITRATE2MBPS;
+    settings.AddressWidth = NRFLite::ADDRESS_WIDTH_5;
+    settings.CrcLength = NRFLite::CRC_1_BYTE;
+    settings.PayloadLength = 8;
+    settings.StaticPayloads = 0;
+    settings.LossPercent = 0;
+    settings.SharedPins = 0;
+    settings.AdaptiveRxWindow = 0;
+    settings.IntervalMicros = 20000;
+    settings.BurstSize = 1;
+    settings.Seconds = 10;
+    settings.Seed = 1;
+    settings.AutoPower = 0;
+    settings.ListenBeforeTalk = 0;
+    settings.Timestamps = 0;
+    settings.RadiusMeters = 0;
+    settings.UpdateBytes = 0;
+    settings.BroadcastCopies = 2;
+    std::string strategy = "all";
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : "";
+
+        if (arg == "--nodes")            { settings.NodeCounts = parseList(value); i++; }
+        else if (arg == "--strategy")    { strategy = value; i++; }
+        else if (arg == "--payload")     { settings.PayloadLength = atoi(value); i++; }
+        else if (arg == "--interval")    { settings.IntervalMicros = atof(value) * 1000; i++; }
+        else if (arg == "--burst")       { settings.BurstSize = std::max(1, atoi(value)); i++; }
+        else if (arg == "--loss")        { settings.LossPercent = atoi(value); i++; }
+        else if (arg == "--seconds")     { settings.Seconds = atoi(value); i++; }
+        else if (arg == "--seed")        { settings.Seed = atoi(value); i++; }
+        else if (arg == "--shared-pins") { settings.SharedPins = 1; }
+        else if (arg == "--adaptive-rx") { settings.AdaptiveRxWindow = 1; }
+        else if (arg == "--static")      { settings.StaticPayloads = 1; }
+        else if (arg == "--auto-power")  { settings.AutoPower = 1; }
+        else if (arg == "--lbt")         { settings.ListenBeforeTalk = 1; }
+        else if (arg == "--timestamps")  { settings.Timestamps = 1; }
+        else if (arg == "--radius")      { settings.RadiusMeters = atof(value); i++; }
+        else if (arg == "--update")      { settings.UpdateBytes = atoi(value); i++; }
+        else if (arg == "--copies")      { settings.BroadcastCopies = atoi(value); i++; }
+        else if (arg == "--crc")         { settings.CrcLength = atoi(value) == 2 ? NRFLite::CRC_2_BYTES : NRFLite::CRC_1_BYTE; i++; }
+        else if (arg == "--address-width")
+        {
+            int width = atoi(value);
+            settings.AddressWidth = width == 3 ? NRFLite::ADDRESS_WIDTH_3 : width == 4 ? NRFLite::ADDRESS_WIDTH_4 : NRFLite::ADDRESS_WIDTH_5;
+            i++;
+        }
+        else if (arg == "--bitrate")
+        {
+            std::string rate = value;
+            settings.Bitrate = rate == "250k" ? NRFLite::BITRATE250KBPS : rate == "1m" ? NRFLite::BITRATE1MBPS : NRFLite::BITRATE2MBPS;
+            i++;
+        }
+        else
+        {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    if (settings.PayloadLength < sizeof(BenchmarkPacket) || settings.PayloadLength > 32)
+    {
+        printf("Payload length must be between %u and 32.\n", (unsigned)sizeof(BenchmarkPacket));
+        return 1;
+    }
+
+    if (settings.UpdateBytes)
+    {
+        if (settings.UpdateBytes > 32 * UPDATE_FRAGMENT_SIZE)
+        {
+            printf("Updates can be up to %u bytes.\n", 32 * UPDATE_FRAGMENT_SIZE);
+            return 1;
+        }
+
+        printf("%-10s %5s %8s %8s %10s %8s %9s %8s %8s %8s\n",
+               "Strategy", "Nodes", "Bytes", "Updated", "TotalMs", "Packets", "AirMs", "Requests", "Repairs", "Spi");
+
+        for (int s = UPDATE_UNICAST; s <= UPDATE_BATCH; s++)
+        {
+            uint8_t isListed = ("," + strategy + ",").find(std::string(",") + UPDATE_STRATEGY_NAMES[s] + ",") != std::string::npos;
+            if (strategy != "all" && !isListed) continue;
+            for (size_t n = 0; n < settings.NodeCounts.size(); n++) runUpdateScenario(settings.NodeCounts[n], (UpdateStrategies)s, settings);
+        }
+
+        return 0;
+    }
+
+    for (int s = STRATEGY_SEND; s <= STRATEGY_QUEUE; s++)
+    {
+        uint8_t isListed = ("," + strategy + ",").find(std::string(",") + STRATEGY_NAMES[s] + ",") != std::string::npos;
+        if (strategy == "all" || isListed) settings.StrategyList.push_back((Strategies)s);
+    }
+
+    printf("%-10s %5s %8s %8s %8s %9s %10s %9s %9s %9s %8s %8s %8s %8s %9s %8s\n",
+           "Strategy", "Nodes", "Offered", "Deliver", "Ratio", "Pkts/s", "Bytes/s",
+           "AvgMs", "P95Ms", "MaxMs", "Collide", "Retries", "uJ/Pkt", "RxSpi/s", "TxSpi/Pkt", "SendUs");
+
+    for (size_t s = 0; s < settings.StrategyList.size(); s++)
+    {
+        for (size_t n = 0; n < settings.NodeCounts.size(); n++)
+        {
+            runScenario(settings.NodeCounts[n], settings.StrategyList[s], settings);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,28 @@
+// Host replacement for the Arduino SPI library.  Bytes go to the emulated radio of the node that is running.
+
+#ifndef _SPI_h_
+#define _SPI_h_
+
+#include "Arduino.h"
+
+#define MSBFIRST 1
+#define SPI_MODE0 0
+
+class SPISettings
+{
+  public:
+    SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+
+class SPIClass
+{
+  public:
+    void begin() {}
+    void beginTransaction(SPISettings) {}
+    uint8_t transfer(uint8_t data);
+    void endTransaction() {}
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,119 @@
+// Arduino core and SPI functions for programs running in the simulator.
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "Simulator.h"
+
+#include <stdlib.h>
+
+using sim::Simulator;
+
+static const uint64_t SPI_BYTE_NANOS = 2000;   // 8 bits at the 4 MHz clock NRFLite uses.
+static const uint64_t SPI_SETUP_NANOS = 1000;  // Toggling CSN and starting the SPI transaction.
+static const uint64_t MICROS_CALL_NANOS = 1000;
+
+HostSerial Serial;
+SPIClass SPI;
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    sim::Node &node = Simulator::Active->current();
+
+    if (pin == node.CsnPin && value == HIGH)
+    {
+        // The SPI transaction takes time on a real MCU, so let the rest of the simulation catch up before it completes.
+        uint64_t spiNanos = node.PendingSpiNanos + SPI_SETUP_NANOS;
+        node.PendingSpiNanos = 0;
+        Simulator::Active->sleep(spiNanos);
+    }
+
+    if (pin == node.CsnPin) node.Chip.setCsn(value);
+    if (pin == node.CePin) node.Chip.setCe(value);
+}
+
+int digitalRead(uint8_t)
+{
+    return LOW;
+}
+
+void delay(unsigned long ms)
+{
+    Simulator::Active->sleep((uint64_t)ms * 1000000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    Simulator::Active->sleep((uint64_t)us * 1000);
+}
+
+unsigned long micros()
+{
+    // Reading the time isn't free, and charging for it lets busy loops that only check micros() make progress.
+    unsigned long now = Simulator::Active->now() / 1000;
+    Simulator::Active->sleep(MICROS_CALL_NANOS);
+    return now;
+}
+
+unsigned long millis()
+{
+    return micros() / 1000;
+}
+
+long random(long howBig)
+{
+    return howBig > 0 ? Simulator::Active->current().Random() % howBig : 0;
+}
+
+long random(long howSmall, long howBig)
+{
+    return howBig > howSmall ? howSmall + random(howBig - howSmall) : howSmall;
+}
+
+void randomSeed(unsigned long seed)
+{
+    Simulator::Active->current().Random.seed(seed);
+}
+
+uint8_t SPIClass::transfer(uint8_t data)
+{
+    sim::Node &node = Simulator::Active->current();
+    node.PendingSpiNanos += SPI_BYTE_NANOS;
+    return node.Chip.transfer(data);
+}
+
+size_t Print::print(const char str[])
+{
+    size_t n = 0;
+    while (*str) n += write(*str++);
+    return n;
+}
+
+size_t Print::print(long n, int base)
+{
+    if (n < 0 && base == DEC) return print('-') + print((unsigned long)-n, base);
+    return print((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+    char buffer[8 * sizeof(long) + 1];
+    char *str = &buffer[sizeof(buffer) - 1];
+    *str = 0;
+
+    do {
+        unsigned long digit = n % base;
+        n /= base;
+        *--str = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    } while (n);
+
+    return print(str);
+}
+
+size_t Print::print(double n, int digits)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+    return print(buffer);
+}
@@ -0,0 +1,739 @@
+#include "Simulator.h"
+
+#include <algorithm>
+#include <math.h>
+#include <new>
+#include <stdlib.h>
+#include "Arduino.h"
+#include "NRFLite.h"
+
+namespace sim {
+
+static const uint64_t NEVER = UINT64_MAX;
+static const uint64_t MICROS = 1000;                 // Nanoseconds per microsecond.
+static const uint64_t POWER_UP_NANOS = 1500 * MICROS; // Tpd2stby, PowerDown to Standby with an external crystal.
+static const uint64_t SETTLING_NANOS = 130 * MICROS;  // Tstby2a, Standby to RX or TX, and the RX/TX turnaround for ACKs.
+static const uint64_t RPD_WINDOW_NANOS = 170 * MICROS;
+static const uint8_t FIFO_SIZE = 3;
+
+// Log-distance path loss with random fading for each packet, typical for 2.4 GHz indoors.
+static const double PATH_LOSS_AT_1_METER_DB = 40;
+static const double PATH_LOSS_EXPONENT = 3;
+static const double FADING_SIGMA_DB = 4;
+static const double CAPTURE_DB = 10;    // A packet survives an overlapping transmission this much weaker than itself.
+static const double RPD_THRESHOLD_DBM = -64;
+
+// Supply current from the datasheet.  TX is indexed by the RF_PWR bits, RX by 2 Mbps, 1 Mbps, and 250 Kbps.
+static const double SUPPLY_VOLTS = 3;
+static const double TX_MILLIAMPS[] = { 7.0, 7.5, 9.0, 11.3 };
+static const double RX_MILLIAMPS[] = { 13.5, 13.1, 12.6 };
+
+Simulator *Simulator::Active;
+
+////////////
+// Radio  //
+////////////
+
+Radio::Radio(Simulator &simulator, uint32_t nodeIndex) :
+    Stats(), _simulator(simulator), _nodeIndex(nodeIndex), _ce(0), _csn(1), _reuse(0), _reusePulsed(0), _rpdLatch(0),
+    _command(-1), _poweredUpAt(NEVER), _rxActiveSince(NEVER), _txGeneration(0), _txState(TX_IDLE), _ackDeadline(0), _ackWaitStart(0),
+    _pid(0), _retransmitCount(0), _expectAck(0)
+{
+    // Reset values from the datasheet.
+    memset(_registers, 0, sizeof(_registers));
+    _registers[CONFIG] = _BV(EN_CRC);
+    _registers[EN_AA] = 0x3F;
+    _registers[EN_RXADDR] = 0x03;
+    _registers[SETUP_AW] = 0x03;
+    _registers[SETUP_RETR] = 0x03;
+    _registers[RF_CH] = 0x02;
+    _registers[RF_SETUP] = 0x0E;
+    _registers[RX_ADDR_P2] = 0xC3;
+    _registers[RX_ADDR_P3] = 0xC4;
+    _registers[RX_ADDR_P4] = 0xC5;
+    _registers[RX_ADDR_P5] = 0xC6;
+    memset(_rxAddrP0, 0xE7, 5);
+    memset(_rxAddrP1, 0xC2, 5);
+    memset(_txAddr, 0xE7, 5);
+    memset(_lastRxPid, 0xFF, sizeof(_lastRxPid));
+}
+
+void Radio::setCe(uint8_t level)
+{
+    if (level && !_ce) _reusePulsed = 1;
+    _ce = level;
+    update();
+}
+
+void Radio::setCsn(uint8_t level)
+{
+    if (!level && _csn)
+    {
+        _command = -1; // Start of a new SPI transaction.
+    }
+    else if (level && !_csn && _command >= 0)
+    {
+        Stats.SpiTransactions++;
+        executeCommand();
+    }
+
+    _csn = level;
+}
+
+uint8_t Radio::transfer(uint8_t mosi)
+{
+    if (_csn) return 0xFF; // Not selected.
+
+    if (_command < 0)
+    {
+        // The first byte is the command and the radio always responds with STATUS.
+        _command = mosi;
+        _spiData.clear();
+
+        if (mosi < W_REGISTER)          _spiReadData = readRegister(mosi & REGISTER_MASK);
+        else if (mosi == R_RX_PL_WID)   _spiReadData = std::vector<uint8_t>(1, _rxFifo.empty() ? 0 : _rxFifo.front().Payload.size());
+        else if (mosi == R_RX_PAYLOAD)  _spiReadData = _rxFifo.empty() ? std::vector<uint8_t>() : _rxFifo.front().Payload;
+        else                            _spiReadData.clear();
+
+        return status();
+    }
+
+    uint8_t index = _spiData.size();
+    _spiData.push_back(mosi);
+    return index < _spiReadData.size() ? _spiReadData[index] : 0;
+}
+
+uint8_t Radio::irqIsActive() const
+{
+    uint8_t unmaskedFlags = _registers[STATUS_NRF] & ~_registers[CONFIG] & (_BV(RX_DR) | _BV(TX_DS) | _BV(MAX_RT));
+    return unmaskedFlags != 0;
+}
+
+void Radio::receive(const Transmission &transmission)
+{
+    if (transmission.Channel != channel() || transmission.DataRate != dataRate()) return;
+
+    uint8_t pipe = matchPipe(transmission.Data.Address);
+    if (pipe > 5) return; // Not addressed to us.
+
+    if (!isListening() || _rxActiveSince > transmission.Start) { Stats.MissedNotListening++; return; }
+    if (transmission.Collided && _simulator.isInterfered(transmission, _nodeIndex)) { Stats.MissedCollision++; return; }
+
+    std::normal_distribution<double> fading(0, FADING_SIGMA_DB);
+    double signalDbm = _simulator.receivedPowerDbm(transmission, _nodeIndex) + fading(_simulator.rng());
+    if (signalDbm < sensitivityDbm())                        { Stats.MissedWeakSignal++; return; }
+    if (_simulator.rng()() % 100 < _simulator.lossPercent()) { Stats.MissedLoss++; return; }
+
+    // Static payloads must match the pipe width, otherwise the CRC is checked against the wrong bytes.
+    const std::vector<uint8_t> &payload = transmission.Data.Payload;
+    uint8_t dynamicPayloads = (_registers[FEATURE] & _BV(EN_DPL)) && (_registers[DYNPD] & _BV(pipe));
+    if (!dynamicPayloads && payload.size() != _registers[RX_PW_P0 + pipe]) { Stats.MissedLoss++; return; }
+
+    if (_rxFifo.size() == FIFO_SIZE) { Stats.MissedRxFull++; return; } // Packet is discarded and not acknowledged.
+
+    uint8_t ackRequested = !transmission.Data.NoAck && (_registers[EN_AA] & _BV(pipe));
+    uint8_t isDuplicate = ackRequested && _lastRxPid[pipe] == transmission.Data.Pid && _lastRxPayload[pipe] == payload;
+
+    if (isDuplicate)
+    {
+        Stats.Duplicates++;
+    }
+    else
+    {
+        FifoEntry entry = { payload, 0, -1, pipe };
+        _rxFifo.push_back(entry);
+        _registers[STATUS_NRF] |= _BV(RX_DR);
+        _lastRxPid[pipe] = transmission.Data.Pid;
+        _lastRxPayload[pipe] = payload;
+        Stats.Received++;
+    }
+
+    if (ackRequested)
+    {
+        Transmission ack = Transmission();
+        ack.NodeIndex = _nodeIndex;
+        ack.AckForNodeIndex = transmission.NodeIndex;
+        ack.Channel = channel();
+        ack.DataRate = dataRate();
+        ack.PowerDbm = powerDbm();
+        ack.Data.Address = transmission.Data.Address;
+        ack.Data.Pid = transmission.Data.Pid;
+        ack.Data.IsAck = 1;
+
+        for (std::deque<FifoEntry>::iterator it = _txFifo.begin(); it != _txFifo.end(); ++it)
+        {
+            if (it->AckPipe == pipe) { ack.Data.Payload = it->Payload; _txFifo.erase(it); break; }
+        }
+
+        uint64_t airtime = airtimeNanos(ack.Data.Payload.size());
+        ack.Start = _simulator.now() + SETTLING_NANOS;
+        ack.End = ack.Start + airtime;
+        Stats.AcksSent++;
+        Stats.AirtimeNanos += airtime;
+        addEnergy(airtime, txMilliamps());
+
+        // The radio switches to TX for the ACK then back to RX, so it can't receive during this time.
+        _rxActiveSince = ack.End + SETTLING_NANOS;
+        _simulator.schedule(SETTLING_NANOS, [this, ack]() { _simulator.transmit(ack); });
+        _simulator.schedule(ack.End + SETTLING_NANOS - _simulator.now(), [this]() { update(); });
+    }
+}
+
+void Radio::receiveAck(const Transmission &transmission)
+{
+    if (_txState != TX_WAITING_FOR_ACK || _simulator.now() > _ackDeadline) return;
+    if (transmission.Data.Address != pipeAddress(0) || transmission.Data.Pid != _pid) return;
+
+    std::normal_distribution<double> fading(0, FADING_SIGMA_DB);
+    double signalDbm = _simulator.receivedPowerDbm(transmission, _nodeIndex) + fading(_simulator.rng());
+    if (signalDbm < sensitivityDbm()) return;
+    if (_simulator.rng()() % 100 < _simulator.lossPercent()) return;
+
+    addEnergy(_simulator.now() - _ackWaitStart, rxMilliamps()); // Listening for the ACK.
+
+    if (!transmission.Data.Payload.empty() && _rxFifo.size() < FIFO_SIZE)
+    {
+        FifoEntry entry = { transmission.Data.Payload, 0, -1, 0 };
+        _rxFifo.push_back(entry);
+        _registers[STATUS_NRF] |= _BV(RX_DR);
+    }
+
+    _registers[STATUS_NRF] |= _BV(TX_DS);
+    completePacket();
+}
+
+uint64_t Radio::airtimeNanos(uint8_t payloadLength) const
+{
+    // ACKs use the same frame, their payload is just empty unless ACK data was loaded.
+    // Preamble + address + 9 bit packet control field + payload + CRC.
+    uint32_t bits = 8 + addressWidth() * 8 + 9 + payloadLength * 8 + crcLength() * 8;
+    uint32_t bitsPerSecond = dataRate() & _BV(RF_DR_LOW) ? 250000 : dataRate() & _BV(RF_DR_HIGH) ? 2000000 : 1000000;
+    return (uint64_t)bits * 1000000000ULL / bitsPerSecond;
+}
+
+uint8_t Radio::status() const
+{
+    uint8_t pipe = _rxFifo.empty() ? 0b111 : _rxFifo.front().Pipe;
+    uint8_t txFull = _txFifo.size() == FIFO_SIZE;
+    return (_registers[STATUS_NRF] & 0b01110000) | (pipe << RX_P_NO) | txFull;
+}
+
+uint8_t Radio::fifoStatus() const
+{
+    return (_reuse ? _BV(TX_REUSE) : 0) |
+           (_txFifo.size() == FIFO_SIZE ? _BV(FIFO_FULL) : 0) |
+           (_txFifo.empty() ? _BV(TX_EMPTY) : 0) |
+           (_rxFifo.size() == FIFO_SIZE ? _BV(RX_FULL) : 0) |
+           (_rxFifo.empty() ? _BV(RX_EMPTY) : 0);
+}
+
+uint8_t Radio::addressWidth() const
+{
+    uint8_t aw = _registers[SETUP_AW] & 0b11;
+    return aw ? aw + 2 : 5; // '00' is illegal, treat it like the 5 byte default.
+}
+
+uint8_t Radio::crcLength() const
+{
+    // Enhanced ShockBurst forces CRC on when auto-acknowledgment is enabled.
+    uint8_t crcEnabled = (_registers[CONFIG] & _BV(EN_CRC)) || _registers[EN_AA];
+    if (!crcEnabled) return 0;
+    return _registers[CONFIG] & _BV(CRCO) ? 2 : 1;
+}
+
+uint8_t Radio::isPoweredUp() const
+{
+    return (_registers[CONFIG] & _BV(PWR_UP)) && _simulator.now() >= _poweredUpAt;
+}
+
+uint8_t Radio::isRxMode() const
+{
+    return isPoweredUp() && (_registers[CONFIG] & _BV(PRIM_RX)) && _ce;
+}
+
+uint8_t Radio::isListening() const
+{
+    return isRxMode() && _rxActiveSince <= _simulator.now();
+}
+
+uint8_t Radio::rpd() const
+{
+    if (!isListening()) return _rpdLatch;
+
+    uint64_t now = _simulator.now();
+    uint64_t from = now - _rxActiveSince < RPD_WINDOW_NANOS ? _rxActiveSince : now - RPD_WINDOW_NANOS;
+    return _simulator.channelWasBusy(_nodeIndex, channel(), from, now);
+}
+
+double Radio::sensitivityDbm() const
+{
+    return dataRate() & _BV(RF_DR_LOW) ? -94 : dataRate() & _BV(RF_DR_HIGH) ? -82 : -85;
+}
+
+double Radio::txMilliamps() const
+{
+    return TX_MILLIAMPS[(_registers[RF_SETUP] >> RF_PWR_LOW) & 0b11];
+}
+
+double Radio::rxMilliamps() const
+{
+    return RX_MILLIAMPS[dataRate() & _BV(RF_DR_LOW) ? 2 : dataRate() & _BV(RF_DR_HIGH) ? 0 : 1];
+}
+
+void Radio::addEnergy(uint64_t nanos, double milliamps)
+{
+    Stats.EnergyMicrojoules += nanos * milliamps * SUPPLY_VOLTS / 1000000.0; // ns x mA x V = pJ
+}
+
+uint8_t Radio::matchPipe(const std::vector<uint8_t> &address) const
+{
+    for (uint8_t pipe = 0; pipe < 6; pipe++)
+    {
+        if ((_registers[EN_RXADDR] & _BV(pipe)) && pipeAddress(pipe) == address) return pipe;
+    }
+
+    return 0xFF;
+}
+
+std::vector<uint8_t> Radio::pipeAddress(uint8_t pipe) const
+{
+    // Pipes 2-5 only have their own least significant byte, the rest comes from pipe 1.
+    std::vector<uint8_t> address(pipe == 0 ? _rxAddrP0 : _rxAddrP1, (pipe == 0 ? _rxAddrP0 : _rxAddrP1) + addressWidth());
+    if (pipe > 1) address[0] = _registers[RX_ADDR_P0 + pipe];
+    return address;
+}
+
+std::vector<uint8_t> Radio::readRegister(uint8_t reg) const
+{
+    if (reg == RX_ADDR_P0) return std::vector<uint8_t>(_rxAddrP0, _rxAddrP0 + 5);
+    if (reg == RX_ADDR_P1) return std::vector<uint8_t>(_rxAddrP1, _rxAddrP1 + 5);
+    if (reg == TX_ADDR)    return std::vector<uint8_t>(_txAddr, _txAddr + 5);
+    if (reg == STATUS_NRF) return std::vector<uint8_t>(1, status());
+    if (reg == FIFO_STATUS) return std::vector<uint8_t>(1, fifoStatus());
+    if (reg == RPD)        return std::vector<uint8_t>(1, rpd());
+    return std::vector<uint8_t>(1, _registers[reg]);
+}
+
+void Radio::writeRegister(uint8_t reg, const std::vector<uint8_t> &data)
+{
+    if (data.empty()) return;
+
+    if (reg == RX_ADDR_P0 || reg == RX_ADDR_P1 || reg == TX_ADDR)
+    {
+        uint8_t *address = reg == RX_ADDR_P0 ? _rxAddrP0 : reg == RX_ADDR_P1 ? _rxAddrP1 : _txAddr;
+        for (uint8_t i = 0; i < data.size() && i < 5; i++) address[i] = data[i];
+    }
+    else if (reg == STATUS_NRF)
+    {
+        _registers[STATUS_NRF] &= ~(data[0] & 0b01110000); // Interrupt flags are cleared by writing 1.
+    }
+    else if (reg == CONFIG)
+    {
+        uint8_t wasPoweredUp = _registers[CONFIG] & _BV(PWR_UP);
+        _registers[CONFIG] = data[0];
+
+        if (!wasPoweredUp && (data[0] & _BV(PWR_UP)))
+        {
+            _poweredUpAt = _simulator.now() + POWER_UP_NANOS;
+            _simulator.schedule(POWER_UP_NANOS, [this]() { update(); });
+        }
+        else if (!(data[0] & _BV(PWR_UP)))
+        {
+            _poweredUpAt = NEVER;
+            _txGeneration++; // PowerDown aborts any transmission.
+            _txState = TX_IDLE;
+            _retransmitCount = 0;
+        }
+    }
+    else if (reg == RF_CH)
+    {
+        _registers[RF_CH] = data[0];
+        _registers[OBSERVE_TX] &= 0x0F; // Writing RF_CH resets the lost packet count.
+    }
+    else if (reg != OBSERVE_TX && reg != RPD && reg != FIFO_STATUS)
+    {
+        _registers[reg] = data[0];
+    }
+}
+
+void Radio::executeCommand()
+{
+    uint8_t command = _command;
+
+    if (command >= W_REGISTER && command < W_REGISTER + 0x20)
+    {
+        writeRegister(command & REGISTER_MASK, _spiData);
+    }
+    else if ((command == W_TX_PAYLOAD || command == W_TX_PAYLOAD_NO_ACK) && !_spiData.empty() && _spiData.size() <= 32)
+    {
+        if (_txFifo.size() < FIFO_SIZE)
+        {
+            FifoEntry entry = { _spiData, command == W_TX_PAYLOAD_NO_ACK, -1, 0 };
+            _txFifo.push_back(entry);
+        }
+        _reuse = 0;
+    }
+    else if (command >= W_ACK_PAYLOAD && command <= W_ACK_PAYLOAD + 5 && !_spiData.empty())
+    {
+        if (_txFifo.size() < FIFO_SIZE)
+        {
+            FifoEntry entry = { _spiData, 0, (int8_t)(command - W_ACK_PAYLOAD), 0 };
+            _txFifo.push_back(entry);
+        }
+    }
+    else if (command == FLUSH_TX)
+    {
+        _txFifo.clear();
+        _reuse = 0;
+    }
+    else if (command == FLUSH_RX)
+    {
+        _rxFifo.clear();
+    }
+    else if (command == REUSE_TX_PL)
+    {
+        _reuse = 1;
+        _reusePulsed = 0;
+    }
+    else if (command == R_RX_PAYLOAD && !_rxFifo.empty())
+    {
+        _rxFifo.pop_front();
+    }
+
+    update();
+}
+
+void Radio::update()
+{
+    // RX mode, the radio starts listening after the settling time.
+    if (isRxMode())
+    {
+        if (_rxActiveSince == NEVER) _rxActiveSince = _simulator.now() + SETTLING_NANOS;
+    }
+    else if (_rxActiveSince != NEVER)
+    {
+        stopRx();
+    }
+
+    // TX mode, start sending if a packet is waiting and the previous packet did not fail.
+    uint8_t isTxMode = isPoweredUp() && !(_registers[CONFIG] & _BV(PRIM_RX)) && _ce;
+    uint8_t hasPacket = _reuse ? _reusePulsed && !_txFifo.empty() : !_txFifo.empty();
+    uint8_t isBlocked = _registers[STATUS_NRF] & _BV(MAX_RT);
+
+    if (isTxMode && hasPacket && !isBlocked && _txState == TX_IDLE)
+    {
+        _txState = TX_SETTLING;
+        _reusePulsed = 0;
+        uint32_t generation = ++_txGeneration;
+        _simulator.schedule(SETTLING_NANOS, [this, generation]() { if (generation == _txGeneration) startTransmission(); });
+    }
+}
+
+void Radio::startTransmission()
+{
+    if (_txFifo.empty())
+    {
+        _txState = TX_IDLE; // Flushed while settling.
+        return;
+    }
+
+    const FifoEntry &entry = _txFifo.front();
+
+    if (_retransmitCount == 0 && !_reuse) _pid = (_pid + 1) & 0b11; // New packets get a new packet id.
+
+    Transmission transmission = Transmission();
+    transmission.NodeIndex = _nodeIndex;
+    transmission.AckForNodeIndex = UINT32_MAX;
+    transmission.Channel = channel();
+    transmission.DataRate = dataRate();
+    transmission.PowerDbm = powerDbm();
+    transmission.Data.Address = std::vector<uint8_t>(_txAddr, _txAddr + addressWidth());
+    transmission.Data.Payload = entry.Payload;
+    transmission.Data.Pid = _pid;
+    transmission.Data.NoAck = entry.NoAck;
+
+    uint64_t airtime = airtimeNanos(entry.Payload.size());
+    transmission.Start = _simulator.now();
+    transmission.End = transmission.Start + airtime;
+
+    _expectAck = !entry.NoAck && (_registers[EN_AA] & _BV(ENAA_P0));
+    _txState = TX_TRANSMITTING;
+    Stats.Transmissions++;
+    Stats.AirtimeNanos += airtime;
+    addEnergy(SETTLING_NANOS + airtime, txMilliamps());
+    if (_retransmitCount) Stats.Retransmissions++;
+
+    _simulator.transmit(transmission);
+
+    uint32_t generation = _txGeneration;
+    _simulator.schedule(airtime, [this, generation]() { endTransmission(generation); });
+}
+
+void Radio::endTransmission(uint32_t generation)
+{
+    if (generation != _txGeneration) return;
+
+    if (!_expectAck)
+    {
+        _registers[STATUS_NRF] |= _BV(TX_DS);
+        completePacket();
+        return;
+    }
+
+    // Auto retransmit delay is measured from the end of one transmission to the start of the next.
+    uint64_t retransmitDelay = ((_registers[SETUP_RETR] >> ARD) + 1) * 250 * MICROS;
+    _txState = TX_WAITING_FOR_ACK;
+    _ackWaitStart = _simulator.now();
+    _ackDeadline = _simulator.now() + retransmitDelay;
+    _simulator.schedule(retransmitDelay, [this, generation]() { ackTimeout(generation); });
+}
+
+void Radio::ackTimeout(uint32_t generation)
+{
+    if (generation != _txGeneration || _txState != TX_WAITING_FOR_ACK) return;
+
+    // The radio only listens long enough to receive the largest ACK, then waits in Standby-II.
+    uint64_t listenNanos = SETTLING_NANOS + airtimeNanos(32);
+    addEnergy(std::min(_simulator.now() - _ackWaitStart, listenNanos), rxMilliamps());
+
+    if (_retransmitCount < (_registers[SETUP_RETR] & 0x0F))
+    {
+        _retransmitCount++;
+        startTransmission();
+    }
+    else
+    {
+        // The packet stays in the TX FIFO and nothing more is sent until MAX_RT is cleared.
+        uint8_t lostCount = _registers[OBSERVE_TX] >> PLOS_CNT;
+        if (lostCount < 15) lostCount++;
+        _registers[OBSERVE_TX] = (lostCount << PLOS_CNT) | _retransmitCount;
+        _registers[STATUS_NRF] |= _BV(MAX_RT);
+        Stats.MaxRetryFailures++;
+
+        _retransmitCount = 0;
+        _txGeneration++;
+        _txState = TX_IDLE;
+    }
+}
+
+void Radio::completePacket()
+{
+    _registers[OBSERVE_TX] = (_registers[OBSERVE_TX] & 0xF0) | _retransmitCount;
+    if (!_reuse && !_txFifo.empty()) _txFifo.pop_front();
+
+    _retransmitCount = 0;
+    _txGeneration++;
+    _txState = TX_IDLE;
+    update();
+}
+
+void Radio::stopRx()
+{
+    // RX current is used from the start of settling, e.g. while a transmitter listens before talking.
+    if (_simulator.now() + SETTLING_NANOS > _rxActiveSince) addEnergy(_simulator.now() + SETTLING_NANOS - _rxActiveSince, rxMilliamps());
+
+    // RPD keeps the value from the end of the last RX period.
+    if (isPoweredUp() && _rxActiveSince <= _simulator.now())
+    {
+        uint64_t now = _simulator.now();
+        uint64_t from = now - _rxActiveSince < RPD_WINDOW_NANOS ? _rxActiveSince : now - RPD_WINDOW_NANOS;
+        _rpdLatch = _simulator.channelWasBusy(_nodeIndex, channel(), from, now);
+    }
+
+    _rxActiveSince = NEVER;
+}
+
+///////////////
+// Simulator //
+///////////////
+
+Simulator::Simulator(uint32_t seed, uint8_t lossPercent) :
+    Stats(), _rng(seed), _now(0), _eventSequence(0), _transmissionId(0), _lossPercent(lossPercent), _current(0)
+{
+    Active = this;
+}
+
+Simulator::~Simulator()
+{
+    for (size_t i = 0; i < _nodes.size(); i++)
+    {
+        free(_nodes[i]->Lib); // Programs never return, so the NRFLite objects are released without destructors.
+        delete _nodes[i];
+    }
+
+    if (Active == this) Active = 0;
+}
+
+Node &Simulator::addNode(std::function<void(Node &node)> program, uint8_t cePin, uint8_t csnPin)
+{
+    Node *node = new Node(*this, _nodes.size());
+    node->CePin = cePin;
+    node->CsnPin = csnPin;
+    node->Program = program;
+    node->Lib = new (calloc(1, sizeof(NRFLite))) NRFLite();
+    _nodes.push_back(node);
+    return *node;
+}
+
+void Simulator::run(uint64_t durationMicros)
+{
+    Active = this;
+    uint64_t end = _now + durationMicros * MICROS;
+
+    for (size_t i = 0; i < _nodes.size(); i++)
+    {
+        if (_nodes[i]->Stack.empty()) start(*_nodes[i]); // Nodes added since an earlier call to 'run' are started now.
+    }
+
+    while (!_events.empty() && _events.top().Time <= end)
+    {
+        Event event = _events.top();
+        _events.pop();
+        _now = event.Time;
+        event.Action();
+    }
+
+    _now = end;
+}
+
+void Simulator::start(Node &node)
+{
+    static const size_t STACK_SIZE = 256 * 1024;
+    node.Stack.resize(STACK_SIZE);
+    getcontext(&node.Context);
+    node.Context.uc_stack.ss_sp = &node.Stack[0];
+    node.Context.uc_stack.ss_size = STACK_SIZE;
+    node.Context.uc_link = &_schedulerContext;
+
+    // makecontext only passes int arguments, so the node pointer is split in two.
+    uintptr_t pointer = reinterpret_cast<uintptr_t>(&node);
+    makecontext(&node.Context, reinterpret_cast<void (*)()>(&Simulator::runProgram), 2,
+                (int)(uint32_t)pointer, (int)(uint32_t)((uint64_t)pointer >> 32));
+
+    Node *nodePointer = &node;
+    schedule(0, [this, nodePointer]() { resume(*nodePointer); });
+}
+
+void Simulator::schedule(uint64_t delayNanos, std::function<void()> action)
+{
+    Event event = { _now + delayNanos, _eventSequence++, action };
+    _events.push(event);
+}
+
+void Simulator::sleep(uint64_t nanos)
+{
+    Node *node = _current;
+    schedule(nanos, [this, node]() { resume(*node); });
+    swapcontext(&node->Context, &_schedulerContext);
+}
+
+void Simulator::transmit(const Transmission &transmission)
+{
+    Transmission t = transmission;
+    t.Id = ++_transmissionId;
+
+    // Overlaps on the same channel are counted here, receivers decide if the overlap corrupted the packet.
+    for (size_t i = 0; i < _air.size(); i++)
+    {
+        Transmission &other = _air[i];
+        if (other.Channel == t.Channel && other.End > t.Start && other.Start < t.End)
+        {
+            if (!other.Collided) Stats.Collisions++;
+            if (!t.Collided) Stats.Collisions++;
+            other.Collided = 1;
+            t.Collided = 1;
+        }
+    }
+
+    // Old transmissions are only kept long enough for RPD and collision checks.
+    static const uint64_t HISTORY_NANOS = 10000 * MICROS;
+    while (!_air.empty() && _air.front().End + HISTORY_NANOS < _now) _air.pop_front();
+
+    _air.push_back(t);
+    Stats.Transmissions++;
+    Stats.BusyNanos += t.End - t.Start;
+
+    uint64_t id = t.Id;
+    schedule(t.End - _now, [this, id]() { endTransmission(id); });
+}
+
+double Simulator::receivedPowerDbm(const Transmission &transmission, uint32_t receivingNodeIndex) const
+{
+    const Node &from = *_nodes[transmission.NodeIndex];
+    const Node &to = *_nodes[receivingNodeIndex];
+    double meters = sqrt((from.X - to.X) * (from.X - to.X) + (from.Y - to.Y) * (from.Y - to.Y));
+    if (meters < 1) meters = 1;
+    return transmission.PowerDbm - PATH_LOSS_AT_1_METER_DB - 10 * PATH_LOSS_EXPONENT * log10(meters);
+}
+
+uint8_t Simulator::isInterfered(const Transmission &transmission, uint32_t receivingNodeIndex) const
+{
+    double signalDbm = receivedPowerDbm(transmission, receivingNodeIndex);
+
+    for (size_t i = 0; i < _air.size(); i++)
+    {
+        const Transmission &other = _air[i];
+        uint8_t overlaps = other.Id != transmission.Id && other.Channel == transmission.Channel &&
+                           other.End > transmission.Start && other.Start < transmission.End;
+        if (overlaps && other.NodeIndex != receivingNodeIndex &&
+            receivedPowerDbm(other, receivingNodeIndex) > signalDbm - CAPTURE_DB) return 1;
+    }
+
+    return 0;
+}
+
+uint8_t Simulator::channelWasBusy(uint32_t listeningNodeIndex, uint8_t channel, uint64_t from, uint64_t to) const
+{
+    for (size_t i = 0; i < _air.size(); i++)
+    {
+        const Transmission &t = _air[i];
+        if (t.NodeIndex != listeningNodeIndex && t.Channel == channel && t.Start < to && t.End > from &&
+            receivedPowerDbm(t, listeningNodeIndex) >= RPD_THRESHOLD_DBM) return 1;
+    }
+
+    return 0;
+}
+
+void Simulator::resume(Node &node)
+{
+    _current = &node;
+    swapcontext(&_schedulerContext, &node.Context);
+    _current = 0;
+}
+
+void Simulator::endTransmission(uint64_t id)
+{
+    const Transmission *t = 0;
+    for (size_t i = 0; i < _air.size(); i++)
+    {
+        if (_air[i].Id == id) { t = &_air[i]; break; }
+    }
+    if (!t) return;
+
+    Transmission transmission = *t; // Receivers may transmit ACKs which can modify the air list.
+
+    if (transmission.Data.IsAck)
+    {
+        uint32_t to = transmission.AckForNodeIndex;
+        if (!transmission.Collided || !isInterfered(transmission, to)) _nodes[to]->Chip.receiveAck(transmission);
+    }
+    else
+    {
+        for (size_t i = 0; i < _nodes.size(); i++)
+        {
+            if (i != transmission.NodeIndex) _nodes[i]->Chip.receive(transmission);
+        }
+    }
+}
+
+void Simulator::runProgram(int nodeLow, int nodeHigh)
+{
+    uintptr_t pointer = (uintptr_t)(uint32_t)nodeLow | ((uintptr_t)(uint32_t)nodeHigh << 32);
+    Node &node = *reinterpret_cast<Node *>(pointer);
+    node.Program(node);
+
+    // Programs normally loop forever, if one returns the node just stops running.
+    for (;;) Active->sleep(UINT64_MAX / 2);
+}
+
+}
@@ -0,0 +1,197 @@
+// Discrete event simulator for running many NRFLite instances against emulated nRF24L01+ radios that share
+// a simulated channel.  Each node runs its program as a coroutine, and the program only gives up control when
+// it waits, which includes delays, calls to micros(), and SPI transactions since these take time on a real MCU.
+//
+// The emulated radio implements the Enhanced ShockBurst features NRFLite uses: auto-acknowledgment with
+// retries, dynamic and static payloads, ACK payloads, NO_ACK packets, payload reuse, and RPD carrier detect.
+// Packets are lost when an overlapping transmission on the same channel is too strong at the receiver, when the
+// receiver is not listening for the entire packet, when the signal is below the receiver's sensitivity after path
+// loss and fading, or randomly based on the configured loss percentage.
+
+#ifndef _Simulator_h_
+#define _Simulator_h_
+
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+#include <ucontext.h>
+
+class NRFLite;
+
+namespace sim {
+
+class Simulator;
+
+struct Packet
+{
+    std::vector<uint8_t> Address;
+    std::vector<uint8_t> Payload;
+    uint8_t Pid, NoAck, IsAck;
+};
+
+struct Transmission
+{
+    uint64_t Id;
+    uint32_t NodeIndex, AckForNodeIndex;
+    uint8_t Channel, DataRate;  // DataRate uses the RF_SETUP RF_DR_LOW and RF_DR_HIGH bits.
+    int8_t PowerDbm;
+    uint64_t Start, End;        // Nanoseconds.
+    uint8_t Collided;
+    Packet Data;
+};
+
+struct RadioStats
+{
+    uint32_t Transmissions, Retransmissions, AcksSent, MaxRetryFailures;
+    uint32_t Received, Duplicates, MissedNotListening, MissedCollision, MissedWeakSignal, MissedLoss, MissedRxFull;
+    uint32_t SpiTransactions;
+    uint64_t AirtimeNanos;
+    double EnergyMicrojoules; // Used while transmitting, listening for ACKs, and in RX mode.
+};
+
+class Radio
+{
+  public:
+    Radio(Simulator &simulator, uint32_t nodeIndex);
+
+    // Pin and SPI interface used by the Arduino shims.
+    void setCe(uint8_t level);
+    void setCsn(uint8_t level);
+    uint8_t transfer(uint8_t mosi);
+    uint8_t irqIsActive() const;
+
+    // Used by the medium.
+    void receive(const Transmission &transmission);
+    void receiveAck(const Transmission &transmission);
+    uint8_t channel() const { return _registers[0x05]; }
+    uint8_t dataRate() const { return _registers[0x06] & 0b00101000; }
+    int8_t powerDbm() const { return -18 + 6 * ((_registers[0x06] >> 1) & 0b11); }
+    uint64_t airtimeNanos(uint8_t payloadLength) const;
+
+    RadioStats Stats;
+
+  private:
+    struct FifoEntry { std::vector<uint8_t> Payload; uint8_t NoAck; int8_t AckPipe; uint8_t Pipe; };
+    enum TxStates : uint8_t { TX_IDLE, TX_SETTLING, TX_TRANSMITTING, TX_WAITING_FOR_ACK };
+
+    Simulator &_simulator;
+    uint32_t _nodeIndex;
+    uint8_t _registers[0x20];
+    uint8_t _rxAddrP0[5], _rxAddrP1[5], _txAddr[5];
+    std::deque<FifoEntry> _txFifo, _rxFifo;
+
+    uint8_t _ce, _csn, _reuse, _reusePulsed, _rpdLatch;
+    int16_t _command;
+    std::vector<uint8_t> _spiData, _spiReadData;
+
+    uint64_t _poweredUpAt, _rxActiveSince;
+    uint32_t _txGeneration;
+    TxStates _txState;
+    uint64_t _ackDeadline, _ackWaitStart;
+    uint8_t _pid, _retransmitCount, _expectAck, _lastRxPid[6];
+    std::vector<uint8_t> _lastRxPayload[6];
+
+    uint8_t status() const;
+    uint8_t fifoStatus() const;
+    uint8_t addressWidth() const;
+    uint8_t crcLength() const;
+    uint8_t isPoweredUp() const;
+    uint8_t isRxMode() const;
+    uint8_t isListening() const;
+    uint8_t rpd() const;
+    double sensitivityDbm() const;
+    double txMilliamps() const;
+    double rxMilliamps() const;
+    void addEnergy(uint64_t nanos, double milliamps);
+    uint8_t matchPipe(const std::vector<uint8_t> &address) const;
+    std::vector<uint8_t> pipeAddress(uint8_t pipe) const;
+    std::vector<uint8_t> readRegister(uint8_t reg) const;
+    void writeRegister(uint8_t reg, const std::vector<uint8_t> &data);
+    void executeCommand();
+    void update();
+    void startTransmission();
+    void endTransmission(uint32_t generation);
+    void ackTimeout(uint32_t generation);
+    void completePacket();
+    void stopRx();
+};
+
+struct Node
+{
+    uint32_t Index;
+    uint8_t CePin, CsnPin;
+    double X, Y; // Position in meters.
+    Radio Chip;
+    NRFLite *Lib;
+    std::function<void(Node &node)> Program;
+    ucontext_t Context;
+    std::vector<char> Stack;
+    uint64_t PendingSpiNanos;
+    std::mt19937 Random; // Used by 'random', seeded the same on every node like unseeded Arduinos.
+
+    Node(Simulator &simulator, uint32_t index) : Index(index), CePin(9), CsnPin(10), X(0), Y(0), Chip(simulator, index), Lib(0), PendingSpiNanos(0) {}
+};
+
+struct MediumStats
+{
+    uint32_t Transmissions, Collisions;
+    uint64_t BusyNanos;
+};
+
+class Simulator
+{
+  public:
+    Simulator(uint32_t seed, uint8_t lossPercent);
+    ~Simulator();
+
+    // Adds a node that runs 'program' once the simulation starts.  Node.Lib is an NRFLite instance
+    // whose memory starts zeroed, like a global object in a sketch.
+    Node &addNode(std::function<void(Node &node)> program, uint8_t cePin = 9, uint8_t csnPin = 10);
+    void run(uint64_t durationMicros);
+
+    uint64_t now() const { return _now; }
+    Node &current() { return *_current; }
+    std::vector<Node *> &nodes() { return _nodes; }
+    std::mt19937 &rng() { return _rng; }
+    uint8_t lossPercent() const { return _lossPercent; }
+
+    // Used by the shims and radios.
+    void schedule(uint64_t delayNanos, std::function<void()> action);
+    void sleep(uint64_t nanos);
+    void transmit(const Transmission &transmission);
+    double receivedPowerDbm(const Transmission &transmission, uint32_t receivingNodeIndex) const;
+    uint8_t isInterfered(const Transmission &transmission, uint32_t receivingNodeIndex) const;
+    uint8_t channelWasBusy(uint32_t listeningNodeIndex, uint8_t channel, uint64_t from, uint64_t to) const;
+
+    MediumStats Stats;
+    static Simulator *Active;
+
+  private:
+    struct Event
+    {
+        uint64_t Time, Sequence;
+        std::function<void()> Action;
+        bool operator>(const Event &other) const { return Time != other.Time ? Time > other.Time : Sequence > other.Sequence; }
+    };
+
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event> > _events;
+    std::vector<Node *> _nodes;
+    std::deque<Transmission> _air;
+    std::mt19937 _rng;
+    uint64_t _now, _eventSequence, _transmissionId;
+    uint8_t _lossPercent;
+    Node *_current;
+    ucontext_t _schedulerContext;
+
+    void start(Node &node);
+    void resume(Node &node);
+    void endTransmission(uint64_t id);
+    static void runProgram(int nodeLow, int nodeHigh);
+};
+
+}
+
+#endif
@@ -0,0 +1,215 @@
+#!/usr/bin/env python3
+"""
+Decodes an SPI trace recorded with NRFLite's startTrace/printTrace and reports where the time was spent.
+
+Capture the serial output of a sketch that calls printTrace, e.g. the SpiTrace example, into a text file then run:
+
+    python3 trace_analyzer.py trace.txt
+    python3 trace_analyzer.py trace.txt --verbose    (also lists every decoded transaction)
+
+Lines that are not 'micros,command,status,length,data' are ignored, so the capture can contain other serial output.
+Command and register names are read from nRF24L01.h so they always match the library.
+
+The retries of a packet are only in the trace when the library reads OBSERVE_TX, which it does after each ACK'd send
+when auto power is enabled.  Otherwise only the retries of failed packets are known, since a packet that raises MAX_RT
+used every retry allowed by the last SETUP_RETR write.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+DEFAULT_HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'src', 'nRF24L01.h')
+TRACE_LINE = re.compile(r'^\s*(\d+),(\d+),(\d+),(\d+),(\d+)\s*$')
+
+
+def load_names(header_path):
+    """Returns (registers, instructions, bits) dictionaries parsed from the sections of nRF24L01.h."""
+    registers, instructions, bits = {}, {}, {}
+    section = None
+
+    with open(header_path) as header:
+        for line in header:
+            comment = re.match(r'\s*/\*\s*(.*?)\s*\*/', line)
+            if comment:
+                section = comment.group(1).lower()
+                continue
+
+            define = re.match(r'\s*#define\s+(\w+)\s+(0x[0-9A-Fa-f]+|\d+)', line)
+            if not define or section is None:
+                continue
+
+            name, value = define.group(1), int(define.group(2), 0)
+            if 'memory map' in section and value <= 0x1F:
+                registers[value] = name  # Later definitions win, so the P model's RPD replaces CD.
+            elif 'memory map' in section or 'instruction' in section:
+                instructions[name] = value  # W_TX_PAYLOAD_NO_ACK is listed in the P model memory map.
+            elif 'bit' in section or 'omissions' in section:
+                bits[name] = value
+
+    return registers, instructions, bits
+
+
+class Decoder:
+
+    def __init__(self, header_path):
+        self.registers, self.instructions, self.bits = load_names(header_path)
+        self.commands = {value: name for name, value in self.instructions.items()
+                         if name not in ('R_REGISTER', 'W_REGISTER', 'REGISTER_MASK')}
+
+    def register_name(self, reg):
+        return self.registers.get(reg, '0x%02X' % reg)
+
+    def command_name(self, command):
+        if command < self.instructions['W_REGISTER']:
+            return 'R_REGISTER ' + self.register_name(command & self.instructions['REGISTER_MASK'])
+        if command < self.instructions['W_REGISTER'] + 0x20:
+            return 'W_REGISTER ' + self.register_name(command & self.instructions['REGISTER_MASK'])
+        if command in self.commands:
+            return self.commands[command]
+
+        ack_payload = self.instructions['W_ACK_PAYLOAD']
+        if ack_payload <= command <= ack_payload + 5:
+            return 'W_ACK_PAYLOAD pipe %d' % (command - ack_payload)
+
+        return '0x%02X' % command
+
+    def is_read(self, command, reg):
+        return command == self.instructions['R_REGISTER'] | reg
+
+    def is_write(self, command, reg):
+        return command == self.instructions['W_REGISTER'] | reg
+
+    def bit(self, value, name):
+        return (value >> self.bits[name]) & 1
+
+
+class Phase:
+
+    def __init__(self, name):
+        self.name, self.durations = name, []
+
+    def add(self, micros):
+        self.durations.append(micros)
+
+    def report(self):
+        d = self.durations
+        if not d:
+            return '%-24s %6d' % (self.name, 0)
+        return '%-24s %6d %10d %8d %8d %8d' % (self.name, len(d), sum(d), min(d), sum(d) // len(d), max(d))
+
+
+def elapsed(start, end):
+    return (end - start) & 0xFFFFFFFF  # micros() wraps every ~70 minutes.
+
+
+def analyze(entries, decoder, verbose):
+    phases = {}
+    def phase(name):
+        return phases.setdefault(name, Phase(name))
+
+    command_counts = {}
+    tx_start, tx_polls, fifo_wait_start, fifo_wait_polls = None, 0, None, 0
+    max_rt_was_set, max_rt_count, tx_ds_was_set, tx_ds_count = False, 0, False, 0
+    observed_retries, observe_tx_reads, retry_limit, failed_retries = 0, 0, 15, 0
+    register = {name: reg for reg, name in decoder.registers.items()}
+    fifo_status, status_reg = register['FIFO_STATUS'], register['STATUS_NRF']
+    config_reg, observe_tx, setup_retr = register['CONFIG'], register['OBSERVE_TX'], register['SETUP_RETR']
+    tx_commands = (decoder.instructions['W_TX_PAYLOAD'], decoder.instructions['W_TX_PAYLOAD_NO_ACK'])
+
+    for i, (micros, command, status, length, data) in enumerate(entries):
+        name = decoder.command_name(command)
+        command_counts[name] = command_counts.get(name, 0) + 1
+        next_micros = entries[i + 1][0] if i + 1 < len(entries) else micros
+
+        if verbose:
+            delta = elapsed(entries[i - 1][0], micros) if i else 0
+            print('%10d %+7d  %-28s status=%s len=%-2d data=0x%02X' %
+                  (micros, delta, name, format(status, '08b'), length, data))
+
+        # Mode transitions.  The time until the next transaction includes the power on delay.
+        if decoder.is_write(command, config_reg):
+            if not decoder.bit(data, 'PWR_UP'):
+                mode = 'PowerDown'
+            elif decoder.bit(data, 'PRIM_RX'):
+                mode = 'RX'
+            else:
+                mode = 'TX'
+            phase('Switch to ' + mode).add(elapsed(micros, next_micros))
+
+        # Retries and failures.  The status byte of every transaction shows TX_DS and MAX_RT being raised and cleared.
+        if decoder.is_write(command, setup_retr):
+            retry_limit = data & 0x0F  # ARC, so the number of retries a failed packet used.
+        if decoder.is_read(command, observe_tx):
+            observed_retries += data & 0x0F
+            observe_tx_reads += 1
+        max_rt_is_set = decoder.bit(status, 'MAX_RT') == 1
+        if max_rt_is_set and not max_rt_was_set:
+            max_rt_count += 1
+            failed_retries += retry_limit
+        max_rt_was_set = max_rt_is_set
+        tx_ds_is_set = decoder.bit(status, 'TX_DS') == 1
+        if tx_ds_is_set and not tx_ds_was_set:
+            tx_ds_count += 1
+        tx_ds_was_set = tx_ds_is_set
+
+        # Sends, from loading the TX buffer until it is empty or a packet fails.
+        if command in tx_commands and tx_start is None:
+            tx_start, tx_polls = micros, 0
+        elif tx_start is not None:
+            tx_done = decoder.is_read(command, fifo_status) and decoder.bit(data, 'TX_EMPTY')
+            if decoder.is_read(command, fifo_status):
+                tx_polls += 1
+            if tx_done or max_rt_is_set:
+                phase('Send failed' if max_rt_is_set else 'Send ok').add(elapsed(tx_start, micros))
+                phase('Send polls').add(tx_polls)
+                tx_start = None
+
+        # FIFO waits, runs of FIFO_STATUS polling with only STATUS reads in between.
+        if decoder.is_read(command, fifo_status):
+            if fifo_wait_start is None:
+                fifo_wait_start, fifo_wait_polls = micros, 0
+            fifo_wait_polls += 1
+        elif not decoder.is_read(command, status_reg) and fifo_wait_start is not None:
+            if fifo_wait_polls > 1:
+                phase('FIFO wait').add(elapsed(fifo_wait_start, micros))
+            fifo_wait_start = None
+
+        if name == 'R_RX_PAYLOAD':
+            phase('RX payload bytes').add(length)
+
+    print('%d transactions over %d us' % (len(entries), elapsed(entries[0][0], entries[-1][0]) if entries else 0))
+    print('%d TX_DS, %d MAX_RT failures using %d retries' % (tx_ds_count, max_rt_count, failed_retries))
+    if observe_tx_reads:
+        print('%d retries reported by %d OBSERVE_TX reads' % (observed_retries, observe_tx_reads))
+    else:
+        print('Retries of sent packets are unknown, OBSERVE_TX is only read when auto power is enabled')
+    print()
+    print('%-24s %6s %10s %8s %8s %8s' % ('Phase', 'Count', 'Total', 'Min', 'Avg', 'Max'))
+    for name in sorted(phases):
+        print(phases[name].report())
+    print()
+    print('%-32s %6s' % ('Command', 'Count'))
+    for name, count in sorted(command_counts.items(), key=lambda item: -item[1]):
+        print('%-32s %6d' % (name, count))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode an NRFLite SPI trace.')
+    parser.add_argument('trace', nargs='?', help='captured serial output, reads stdin if omitted')
+    parser.add_argument('--header', default=DEFAULT_HEADER, help='path to nRF24L01.h')
+    parser.add_argument('--verbose', action='store_true', help='list every decoded transaction')
+    args = parser.parse_args()
+
+    source = open(args.trace) if args.trace else sys.stdin
+    entries = [tuple(int(v) for v in match.groups()) for match in map(TRACE_LINE.match, source) if match]
+
+    if not entries:
+        sys.exit('No trace entries found.')
+
+    analyze(entries, Decoder(args.header), args.verbose)
+
+
+if __name__ == '__main__':
+    main()
@@ -13,6 +13,11 @@
     static const uint8_t USI_SCK = 2; // PB2
 #else
     #include "SPI.h" // Use the normal Arduino hardware SPI library.
+    static const uint32_t NRF_SPICLOCK = 4000000;
+#endif
+
+#if defined(__AVR__)
+    static const uint16_t CSN_DISCHARGE_MICROS = 500; // Time for the capacitor on CSN to charge or discharge in 2-pin mode.
 #endif
 
 ////////////
@@ -32,6 +37,41 @@ void NRFLite::addAckData(void *data, uint8_t length, uint8_t removeExistingAcks)
     spiTransfer(WRITE_OPERATION, (W_ACK_PAYLOAD | 1), data, length);
 }
 
+void NRFLite::addLatency(LatencyStats &stats, uint32_t latencyMicros)
+{
+    if (stats.Count == 0 || latencyMicros < stats.MinMicros) stats.MinMicros = latencyMicros;
+    if (latencyMicros > stats.MaxMicros) stats.MaxMicros = latencyMicros;
+
+    // Jitter moves 1/16 of the way towards each new difference between consecutive samples.
+    if (stats.Count > 0)
+    {
+        uint32_t difference = latencyMicros > stats.LastMicros ? latencyMicros - stats.LastMicros : stats.LastMicros - latencyMicros;
+        stats.JitterMicros += ((int32_t)difference - (int32_t)stats.JitterMicros) / 16;
+    }
+
+    stats.Count++;
+    stats.TotalMicros += latencyMicros;
+    stats.LastMicros = latencyMicros;
+
+    uint8_t bucket = 0;
+    uint32_t bucketLimit = 128;
+
+    while (bucket < LATENCY_BUCKETS - 1 && latencyMicros >= bucketLimit)
+    {
+        bucket++;
+        bucketLimit <<= 1;
+    }
+
+    if (stats.Buckets[bucket] < 0xFFFF) stats.Buckets[bucket]++;
+}
+
+uint8_t NRFLite::broadcast(uint8_t groupId, void *data, uint8_t length, uint8_t copies)
+{
+    uint8_t sequence = _nextBroadcastSequence++;
+    sendBroadcast(groupId, sequence, data, length, copies);
+    return sequence;
+}
+
 void NRFLite::discardData(uint8_t unexpectedDataLength)
 {
     // Read data from the RX buffer.
@@ -40,6 +80,81 @@ void NRFLite::discardData(uint8_t unexpectedDataLength)
 
     // Clear data received flag.
     writeRegister(STATUS_NRF, _BV(RX_DR));
+    if (_timestampHook) _timestampHook(*this, RX_READ);
+    if (_rxBurstCount < 255) _rxBurstCount++;
+}
+
+uint8_t NRFLite::dispatchMessage()
+{
+    uint8_t packetLength = hasData();
+    if (packetLength == 0) return 0;
+
+    // Read the message id, then the reader for that message type finishes the same SPI transaction,
+    // reading the rest of the packet directly into a message of the correct type.
+    spiBegin();
+    uint8_t statusReg = spiTransferByte(R_RX_PAYLOAD);
+    uint8_t messageId = spiTransferByte(NRF_NOP);
+    uint8_t messageLength = packetLength - 1;
+    if (_traceRecorder) _traceRecorder(*this, R_RX_PAYLOAD, statusReg, packetLength, messageId);
+
+    if (messageId < _messageRouteCount && _messageRoutes[messageId].Reader)
+    {
+        MessageRoute &route = _messageRoutes[messageId];
+        return route.Reader(*this, route.Handler, messageLength);
+    }
+    else
+    {
+        endMessageRead(NULL, 0, messageLength); // No handler was registered so discard the message.
+        return 0;
+    }
+}
+
+uint8_t NRFLite::enqueue(uint8_t toRadioId, void *data, uint8_t length, SendType sendType)
+{
+    if (_queueCount == _queueSize) return QUEUE_IS_FULL;
+
+    uint8_t index = (_queueFirst + _queueCount) % _queueSize;
+    QueuedPacket &packet = _queue[index];
+    packet.ToRadioId = toRadioId;
+    packet.Type = sendType;
+    packet.Status = QUEUE_WAITING;
+    packet.Length = length > 32 ? 32 : length;
+    memcpy(packet.Data, data, packet.Length);
+    _queueCount++;
+
+    // The radio only interrupts while it has packets to send, so load the packet now if it has none.
+    if (_queueLoadedCount == 0)
+    {
+        _usingInterrupts = 1;
+        loadQueue();
+    }
+
+    return index;
+}
+
+int32_t NRFLite::getClockOffset(uint32_t sendMicros, uint32_t remoteRxMicros, uint32_t ackMicros)
+{
+    // The other radio received the packet halfway through the round trip.  Unsigned subtraction handles micros() overflow.
+    return (int32_t)(remoteRxMicros - sendMicros - (ackMicros - sendMicros) / 2);
+}
+
+uint32_t NRFLite::getMissedBroadcasts(uint8_t &newestSequence)
+{
+    // Only sequence numbers since the first broadcast received are reported.
+    newestSequence = _newestBroadcastSequence;
+    uint32_t tracked = _trackedBroadcasts < 32 ? ((uint32_t)1 << _trackedBroadcasts) - 1 : 0xFFFFFFFF;
+    return ~_receivedBroadcasts & tracked;
+}
+
+NRFLite::PowerLevels NRFLite::getPowerLevel(uint8_t toRadioId)
+{
+    PowerEntry *entry = findPowerEntry(toRadioId);
+    return entry ? (PowerLevels)entry->Level : POWER_0DBM;
+}
+
+uint8_t NRFLite::getQueueCount()
+{
+    return _queueCount;
 }
 
 uint8_t NRFLite::hasAckData()
@@ -58,26 +173,21 @@ uint8_t NRFLite::hasAckData()
 
 uint8_t NRFLite::hasData(uint8_t usingInterrupts)
 {
-    static uint32_t microsSinceLastRxCheck;
-
     _usingInterrupts = usingInterrupts;
 
-    if (!_usingSeparateCeAndCsnPins)
+    // Shared CE and CSN pin operation requires CE to stay HIGH long enough for the radio to receive data.
+    // If not using interrupts, we must rate-limit checks to prevent CE from being LOW too frequently.
+    // When using interrupts we assume the calling program knows data was received, so we bypass this rate limiter.
+    uint8_t usingRxWindow = !_usingSeparateCeAndCsnPins && !usingInterrupts;
+
+    if (usingRxWindow)
     {
-        // Shared CE and CSN pin operation requires CE to stay HIGH long enough for the radio to receive data.
-        // If not using interrupts, we must rate-limit checks to prevent CE from being LOW too frequently.
-        // When using interrupts we assume the calling program knows data was received, so we bypass this rate limiter.
-        if (!usingInterrupts)
+        if (microsUntilRxCheck())
         {
-            uint8_t giveRadioMoreRxTime = micros() - microsSinceLastRxCheck < _minRxTimeMicros;
-
-            if (giveRadioMoreRxTime)
-            {
-                return 0; // Prevent calling program from forcing us to bring CE low, making the radio stop receiving.
-            }
-
-            microsSinceLastRxCheck = micros();
+            return 0; // Prevent calling program from forcing us to bring CE low, making the radio stop receiving.
         }
+
+        _lastRxCheckMicros = micros();
     }
 
     // We enable several features so if none are on, the radio must have lost its configuration.
@@ -91,19 +201,17 @@ uint8_t NRFLite::hasData(uint8_t usingInterrupts)
     else
     {
         // Just start RX mode if needed.
-        uint8_t notInRxMode = readRegister(CONFIG) != CONFIG_REG_FOR_RX_MODE;
+        uint8_t notInRxMode = readRegister(CONFIG) != _configRegForRxMode;
         if (notInRxMode) startRx();
     }
 
     // If we have a pipe 1 packet sitting at the top of the RX buffer, we have data.
-    if (getPipeOfFirstRxPacket() == 1)
-    {
-        return getRxPacketLength(); // Return the length of the data packet in the RX buffer.
-    }
-    else
-    {
-        return 0;
-    }
+    uint8_t dataLength = getPipeOfFirstRxPacket() == 1 ? getRxPacketLength() : 0;
+    if (usingRxWindow && !dataLength) updateRxWindow();
+
+    if (dataLength && _timestampHook) _timestampHook(*this, usingInterrupts ? RX_FOUND_ISR : RX_FOUND);
+
+    return dataLength;
 }
 
 uint8_t NRFLite::hasDataISR()
@@ -172,6 +280,22 @@ uint8_t NRFLite::initTwoPin(uint8_t radioId, uint8_t momiPin, uint8_t sckPin, Bi
 
 #endif
 
+void NRFLite::listenForBroadcasts(uint8_t groupId)
+{
+    _isListeningForBroadcasts = 1;
+    _broadcastGroupId = groupId;
+}
+
+uint16_t NRFLite::microsUntilRxCheck()
+{
+    // With the adaptive RX window, packets left in the RX buffer by the last check are read right away, since the radio
+    // drops new packets when it's full.
+    if (_usingSeparateCeAndCsnPins || (_usingAdaptiveRxWindow && _rxBurstCount)) return 0;
+
+    uint32_t elapsedMicros = micros() - _lastRxCheckMicros;
+    return elapsedMicros < _rxWindowMicros ? _rxWindowMicros - elapsedMicros : 0;
+}
+
 void NRFLite::powerDown()
 {
     if (_usingSeparateCeAndCsnPins)
@@ -181,55 +305,153 @@ void NRFLite::powerDown()
     }
 
     // Enter PowerDown mode.
-    writeRegister(CONFIG, CONFIG_REG_FOR_RX_MODE & ~_BV(PWR_UP));
+    writeRegister(CONFIG, _configRegForRxMode & ~_BV(PWR_UP));
 }
 
 void NRFLite::printDetails()
 {
-    printRegister("CONFIG", readRegister(CONFIG));
-    printRegister("EN_AA", readRegister(EN_AA));
-    printRegister("EN_RXADDR", readRegister(EN_RXADDR));
-    printRegister("SETUP_AW", readRegister(SETUP_AW));
-    printRegister("SETUP_RETR", readRegister(SETUP_RETR));
-    printRegister("RF_CH", readRegister(RF_CH));
-    printRegister("RF_SETUP", readRegister(RF_SETUP));
-    printRegister("STATUS", readRegister(STATUS_NRF));
-    printRegister("OBSERVE_TX", readRegister(OBSERVE_TX));
-    printRegister("RX_PW_P0", readRegister(RX_PW_P0));
-    printRegister("RX_PW_P1", readRegister(RX_PW_P1));
-    printRegister("FIFO_STATUS", readRegister(FIFO_STATUS));
-    printRegister("DYNPD", readRegister(DYNPD));
-    printRegister("FEATURE", readRegister(FEATURE));
-
-    uint8_t data[5];
-
-    String msg = "TX_ADDR ";
-    readRegister(TX_ADDR, &data, 5);
-    for (uint8_t i = 0; i < 4; i++) { msg += data[i]; msg += ','; }
-    msg += data[4];
-
-    msg += "\nRX_ADDR_P0 ";
-    readRegister(RX_ADDR_P0, &data, 5);
-    for (uint8_t i = 0; i < 4; i++) { msg += data[i]; msg += ','; }
-    msg += data[4];
-
-    msg += "\nRX_ADDR_P1 ";
-    readRegister(RX_ADDR_P1, &data, 5);
-    for (uint8_t i = 0; i < 4; i++) { msg += data[i]; msg += ','; }
-    msg += data[4];
-
-    debugln(msg);
+    if (!_serial) return;
+
+    RegisterSnapshot snapshot;
+    readSnapshot(snapshot);
+    printSnapshot(*_serial, snapshot);
+}
+
+void NRFLite::printLatency(Print &output, const LatencyStats &stats)
+{
+    output.print(F("Count ")); output.println(stats.Count);
+    if (!stats.Count) return;
+
+    output.print(F("Min ")); output.println(stats.MinMicros);
+    output.print(F("Mean ")); output.println((uint32_t)(stats.TotalMicros / stats.Count));
+    output.print(F("Max ")); output.println(stats.MaxMicros);
+    output.print(F("Jitter ")); output.println(stats.JitterMicros);
+
+    // Each bucket is printed with the limit of the samples it counts, the last counts all longer samples.
+    uint32_t bucketLimit = 128;
+
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        if (i < LATENCY_BUCKETS - 1) { output.print('<'); output.print(bucketLimit); }
+        else { output.print(F(">=")); output.print(bucketLimit >> 1); }
+        output.print(' ');
+        output.println(stats.Buckets[i]);
+        bucketLimit <<= 1;
+    }
+}
+
+void NRFLite::printSnapshot(Print &output, const RegisterSnapshot &snapshot)
+{
+    // Output is streamed one value at a time with register names kept in flash, so no RAM buffer is needed.
+    printRegister(output, F("CONFIG"), snapshot.Config);
+    printRegister(output, F("EN_AA"), snapshot.EnAa);
+    printRegister(output, F("EN_RXADDR"), snapshot.EnRxAddr);
+    printRegister(output, F("SETUP_AW"), snapshot.SetupAw);
+    printRegister(output, F("SETUP_RETR"), snapshot.SetupRetr);
+    printRegister(output, F("RF_CH"), snapshot.RfCh);
+    printRegister(output, F("RF_SETUP"), snapshot.RfSetup);
+    printRegister(output, F("STATUS"), snapshot.Status);
+    printRegister(output, F("OBSERVE_TX"), snapshot.ObserveTx);
+    if (snapshot.HasRpd) printRegister(output, F("RPD"), snapshot.Rpd);
+    printRegister(output, F("RX_PW_P0"), snapshot.RxPwP0);
+    printRegister(output, F("RX_PW_P1"), snapshot.RxPwP1);
+    printRegister(output, F("FIFO_STATUS"), snapshot.FifoStatus);
+    printRegister(output, F("DYNPD"), snapshot.Dynpd);
+    printRegister(output, F("FEATURE"), snapshot.Feature);
+    printAddress(output, F("TX_ADDR"), snapshot.TxAddr);
+    printAddress(output, F("RX_ADDR_P0"), snapshot.RxAddrP0);
+    printAddress(output, F("RX_ADDR_P1"), snapshot.RxAddrP1);
+}
+
+void NRFLite::printTrace(Print &output)
+{
+    if (!_traceEntryCount) return;
+
+    // Oldest entry is at the current index once the array has wrapped around.
+    uint8_t count = _traceIsFull ? _traceEntryCount : _traceIndex;
+    uint8_t index = _traceIsFull ? _traceIndex : 0;
+
+    while (count--)
+    {
+        TraceEntry &entry = _traceEntries[index];
+        output.print(entry.Micros); output.print(',');
+        output.print(entry.Command); output.print(',');
+        output.print(entry.Status); output.print(',');
+        output.print(entry.Length); output.print(',');
+        output.println(entry.Data);
+
+        if (++index == _traceEntryCount) index = 0;
+    }
+}
+
+uint8_t NRFLite::readBroadcast(void *data, uint8_t &sequence)
+{
+    // Broadcasts are the pipe 0 packets received while in RX mode.
+    while (_isListeningForBroadcasts && getPipeOfFirstRxPacket() == 0)
+    {
+        uint8_t packetLength = getRxPacketLength();
+        if (packetLength == 0) return 0; // An invalid packet was removed.
+
+        // Read the sequence number, then read the rest of the packet in the same SPI transaction.
+        spiBegin();
+        uint8_t statusReg = spiTransferByte(R_RX_PAYLOAD);
+        sequence = spiTransferByte(NRF_NOP);
+        uint8_t dataLength = packetLength - 1;
+        if (_traceRecorder) _traceRecorder(*this, R_RX_PAYLOAD, statusReg, packetLength, sequence);
+
+        if (isNewBroadcast(sequence))
+        {
+            endMessageRead(data, dataLength, dataLength);
+            return dataLength;
+        }
+        else
+        {
+            endMessageRead(NULL, 0, dataLength); // Discard the duplicate and check for another broadcast.
+        }
+    }
+
+    return 0;
 }
 
 void NRFLite::readData(void *data)
 {
     // Determine length of data in the RX buffer and read it.
-    uint8_t dataLength;
-    spiTransfer(READ_OPERATION, R_RX_PL_WID, &dataLength, 1);
+    uint8_t dataLength = _staticPayloadLength;
+    if (!dataLength) spiTransfer(READ_OPERATION, R_RX_PL_WID, &dataLength, 1);
     spiTransfer(READ_OPERATION, R_RX_PAYLOAD, data, dataLength);
 
     // Clear the data received flag if not using interrupts.
     if (!_usingInterrupts) writeRegister(STATUS_NRF, _BV(RX_DR));
+    if (_timestampHook) _timestampHook(*this, RX_READ);
+    if (_rxBurstCount < 255) _rxBurstCount++;
+}
+
+void NRFLite::readSnapshot(RegisterSnapshot &snapshot, uint8_t includeRpd)
+{
+    // Every SPI transaction returns the STATUS register as its first byte, so it doesn't need a read of its own.
+    snapshot.Status = readRegister(CONFIG, &snapshot.Config, 1);
+    readRegister(EN_AA, &snapshot.EnAa, 1);
+    readRegister(EN_RXADDR, &snapshot.EnRxAddr, 1);
+    readRegister(SETUP_AW, &snapshot.SetupAw, 1);
+    readRegister(SETUP_RETR, &snapshot.SetupRetr, 1);
+    readRegister(RF_CH, &snapshot.RfCh, 1);
+    readRegister(RF_SETUP, &snapshot.RfSetup, 1);
+    readRegister(OBSERVE_TX, &snapshot.ObserveTx, 1);
+    snapshot.Rpd = includeRpd ? readRegister(RPD) : 0;
+    snapshot.HasRpd = includeRpd ? 1 : 0;
+    readRegister(RX_PW_P0, &snapshot.RxPwP0, 1);
+    readRegister(RX_PW_P1, &snapshot.RxPwP1, 1);
+    readRegister(FIFO_STATUS, &snapshot.FifoStatus, 1);
+    readRegister(DYNPD, &snapshot.Dynpd, 1);
+    readRegister(FEATURE, &snapshot.Feature, 1);
+    readRegister(TX_ADDR, &snapshot.TxAddr, 5);
+    readRegister(RX_ADDR_P0, &snapshot.RxAddrP0, 5);
+    readRegister(RX_ADDR_P1, &snapshot.RxAddrP1, 5);
+}
+
+void NRFLite::rebroadcast(uint8_t groupId, uint8_t sequence, void *data, uint8_t length, uint8_t copies)
+{
+    sendBroadcast(groupId, sequence, data, length, copies);
 }
 
 uint8_t NRFLite::scanChannel(uint8_t channel, uint8_t measurementCount)
@@ -237,7 +459,7 @@ uint8_t NRFLite::scanChannel(uint8_t channel, uint8_t measurementCount)
     uint8_t strength = 0;
 
     // Ensure radio is configured for RX.
-    uint8_t notInRxModeOrRadioNotConfigured = readRegister(CONFIG) != CONFIG_REG_FOR_RX_MODE;
+    uint8_t notInRxModeOrRadioNotConfigured = readRegister(CONFIG) != _configRegForRxMode;
     if (notInRxModeOrRadioNotConfigured)
     {
         initRadio(_savedRadioId, _savedBitrate, _savedChannel);
@@ -267,26 +489,211 @@ uint8_t NRFLite::scanChannel(uint8_t channel, uint8_t measurementCount)
 }
 
 uint8_t NRFLite::send(uint8_t toRadioId, void *data, uint8_t length, SendType sendType)
+{
+    return sendPacket(toRadioId, NO_HEADER, data, length, sendType);
+}
+
+uint8_t NRFLite::sendBatch(BatchItem items[], uint8_t itemCount, SendType sendType)
 {
     _usingInterrupts = 0;
 
-    // Clear any previously asserted TX success or max retries flags.
-    writeRegister(STATUS_NRF, _BV(TX_DS) | _BV(MAX_RT));
+    // Finish any packets already in the TX buffer, so their TX_DS is not taken for an item, then clear any
+    // previously asserted TX success or max retries flags.
+    waitForTx(_usingInterrupts);
+    clearStatusFlags(_BV(TX_DS) | _BV(MAX_RT));
 
-    // Ensure radio is in Standby-II mode and the TX buffer has room for the outgoing packet.
-    startTx(toRadioId, sendType);
+    for (uint8_t i = 0; i < itemCount; i++) items[i].Status = QUEUE_WAITING;
 
-    // Add data to the TX buffer, with or without an ACK request.
-    if (sendType == NO_ACK) { spiTransfer(WRITE_OPERATION, W_TX_PAYLOAD_NO_ACK, data, length); }
-    else                    { spiTransfer(WRITE_OPERATION, W_TX_PAYLOAD       , data, length); }
+    uint8_t sentCount = 0;
 
-    // Wait for the TX buffer to be empty.
-    uint8_t packetWasSent = waitForTx(_usingInterrupts);
-    return packetWasSent;
+    for (uint8_t first = 0; first < itemCount; first++)
+    {
+        if (items[first].Status != QUEUE_WAITING) continue; // Already sent with an earlier item to the same radio.
+
+        uint8_t toRadioId = items[first].ToRadioId;
+
+        // Ensure radio is in Standby-II mode with this destination's address.
+        startTx(toRadioId, sendType);
+
+        // Keep the TX buffer loaded with the items for this radio until they are all complete.  As with the packet
+        // queue, only 2 are loaded at a time so the result of each one is known.
+        uint8_t loaded[MAX_LOADED_QUEUE_PACKETS];
+        uint8_t loadedCount = 0;
+        uint8_t next = first;
+
+        while (1)
+        {
+            while (loadedCount < MAX_LOADED_QUEUE_PACKETS && next < itemCount)
+            {
+                BatchItem &item = items[next];
+
+                if (item.ToRadioId == toRadioId)
+                {
+                    writeTxPayload(sendType, item.Data, item.Length > 32 ? 32 : item.Length);
+                    item.Status = QUEUE_SENDING;
+                    loaded[loadedCount++] = next;
+                }
+
+                next++;
+            }
+
+            if (loadedCount == 0) break;
+
+            sentCount += completeBatchItems(items, loaded, loadedCount, sendType);
+        }
+    }
+
+    return sentCount;
+}
+
+void NRFLite::sendBeacon()
+{
+    // Another send or RX mode ended beaconing, so CE and the beacon data may no longer be what the beacon needs.
+    if (!_beaconHook) return;
+
+    if (_usingSeparateCeAndCsnPins)
+    {
+        // The radio sends the reused payload once for every CE pulse, which must be at least 10 uS long.
+        digitalWrite(_cePin, HIGH);
+        delayMicroseconds(10);
+        digitalWrite(_cePin, LOW);
+    }
+    else
+    {
+        writeTxPayload(NO_ACK, _beacon->Data, _beacon->Length);
+    }
+
+    _beacon->LastMicros = micros();
+}
+
+uint8_t NRFLite::serviceQueue()
+{
+    _usingInterrupts = 1;
+
+    // RX_DR is cleared too so the IRQ pin is released, since 'hasDataISR' would switch the radio to RX mode.
+    uint8_t statusReg = clearStatusFlags(_BV(TX_DS) | _BV(MAX_RT) | _BV(RX_DR));
+    uint8_t packetWasSent = statusReg & _BV(TX_DS);
+    uint8_t packetCouldNotBeSent = statusReg & _BV(MAX_RT);
+
+    if (packetCouldNotBeSent)
+    {
+        // The radio stops at the failed packet, so a TX_DS means the packet loaded before it was sent.
+        // Flushing also removes the packet loaded after it, which is loaded again below.
+        if (packetWasSent && _queueLoadedCount > 1) completeQueuedPacket(QUEUE_SENT);
+        completeQueuedPacket(QUEUE_FAILED);
+        spiTransfer(WRITE_OPERATION, FLUSH_TX, NULL, 0);
+        _queueLoadedCount = 0;
+        setRetryDelay(getRandom(4));
+    }
+    else if (packetWasSent)
+    {
+        // With at most 2 packets loaded, an empty TX buffer means both were sent, otherwise only the first was.
+        uint8_t txBufferIsEmpty = readRegister(FIFO_STATUS) & _BV(TX_EMPTY);
+        completeQueuedPacket(QUEUE_SENT);
+
+        if (txBufferIsEmpty && _queueLoadedCount)
+        {
+            // The second packet may have been sent after the flags were cleared, and its TX_DS must not be
+            // taken for the next packets loaded.
+            completeQueuedPacket(QUEUE_SENT);
+            writeRegister(STATUS_NRF, _BV(TX_DS));
+        }
+    }
+
+    loadQueue();
+
+    // A failure switched to a random retry delay, which is only needed while the colliding packets are queued.
+    if (!_queueCount && _retryDelaySteps) setRetryDelay(0);
+
+    return (statusReg >> RX_DR) & 1;
+}
+
+void NRFLite::setAdaptiveRxWindow(uint8_t enabled)
+{
+    _usingAdaptiveRxWindow = enabled;
+    _rxWindowMicros = _minRxTimeMicros;
+}
+
+void NRFLite::setAddressPrefix(const uint8_t prefix[4])
+{
+    memcpy(_addressPrefix, prefix, sizeof(_addressPrefix));
+}
+
+void NRFLite::setAutoPower(PowerEntry entries[], uint8_t entryCount)
+{
+    // The power is changed by 'startTx' since the radio may not be initialized yet.  The hook stays set with no
+    // entries, so the next packet after disabling returns to 0 dBm.
+    memset(entries, 0, entryCount * sizeof(PowerEntry));
+    _powerEntries = entries;
+    _powerEntryCount = entryCount;
+    _powerEntryToReplace = 0;
+    _autoPowerHook = &adjustPower;
+}
+
+void NRFLite::setListenBeforeTalk(uint8_t enabled)
+{
+    _listenBeforeTalkHook = enabled ? &waitForClearChannel : NULL;
+    if (!enabled && _retryDelaySteps) setRetryDelay(0);
+}
+
+void NRFLite::setPacketFormat(AddressWidths addressWidth, CrcLengths crcLength, uint8_t staticPayloadLength)
+{
+    _addressWidth = addressWidth;
+    _staticPayloadLength = staticPayloadLength > 32 ? 32 : staticPayloadLength;
+
+    // CRCO selects a 2 byte CRC, otherwise a 1 byte CRC is used.
+    _configRegForRxMode = _BV(PWR_UP) | _BV(PRIM_RX) | _BV(EN_CRC);
+    if (crcLength == CRC_2_BYTES) _configRegForRxMode |= _BV(CRCO);
+}
+
+void NRFLite::setTimestamps(Timestamps *timestamps)
+{
+    if (timestamps) memset(timestamps, 0, sizeof(Timestamps));
+    _timestamps = timestamps;
+    _timestampHook = timestamps ? &recordTimestamp : NULL;
+}
+
+void NRFLite::startBeacon(Beacon &beacon, uint8_t toRadioId, void *data, uint8_t length)
+{
+    // Ensure radio is in Standby-II mode with the TX configuration and destination address.
+    startTx(toRadioId, NO_ACK);
+
+    beacon.Data = data;
+    beacon.Length = length;
+    beacon.LastMicros = micros() - _txRetryMicros;
+    _beacon = &beacon;
+    _beaconHook = &endBeacon;
+
+    if (_usingSeparateCeAndCsnPins)
+    {
+        // Send any queued packets, then enter Standby-I mode so the beacon is only sent when CE is pulsed.
+        static const uint8_t ALL_PACKETS_SENT = 0;
+        waitForTx(ALL_PACKETS_SENT);
+        digitalWrite(_cePin, LOW);
+        loadBeacon();
+    }
+}
+
+void NRFLite::startMessages(MessageRoute routes[], uint8_t routeCount)
+{
+    memset(routes, 0, routeCount * sizeof(MessageRoute)); // Message ids without a handler are discarded.
+    _messageRoutes = routes;
+    _messageRouteCount = routeCount;
+}
+
+void NRFLite::startQueue(QueuedPacket packets[], uint8_t packetCount)
+{
+    _queue = packets;
+    _queueSize = packetCount == QUEUE_IS_FULL ? packetCount - 1 : packetCount; // Indexes must not equal QUEUE_IS_FULL.
+    _queueFirst = 0;
+    _queueCount = 0;
+    _queueLoadedCount = 0;
 }
 
 uint8_t NRFLite::startRx()
 {
+    if (_beaconHook) _beaconHook(*this, RX_STARTED);
+
     // Ensure all packets in the TX buffer are sent before switching into RX mode.
     static const uint8_t ALL_PACKETS_SENT = 0;
     waitForTx(ALL_PACKETS_SENT);
@@ -306,40 +713,88 @@ uint8_t NRFLite::startRx()
         powerDown(); // PowerDown mode.
     }
 
-    writeRegister(CONFIG, CONFIG_REG_FOR_RX_MODE); // RX configuration and Power on, then Standby-I mode.
+    if (_autoPowerHook) _autoPowerHook(*this, RX_STARTED);
+
+    if (_isListeningForBroadcasts)
+    {
+        // RX pipe 0 receives broadcasts while in RX mode.  Pipes 2-5 can't be used for the group address since they
+        // share all but their least significant address byte with pipe 1, which contains this radio's id.
+        // The next transmission will restore the pipe 0 address needed to receive ACK packets.
+        writeAddress(RX_ADDR_P0, _broadcastGroupId, 1);
+        _lastToRadioId = -1;
+    }
+
+    writeRegister(CONFIG, _configRegForRxMode); // RX configuration and Power on, then Standby-I mode.
     digitalWrite(_cePin, HIGH);                    // RX mode.
     delay(POWERDOWN_TO_RXTX_MODE_MILLIS);          // Power on delay.
 
-    uint8_t readyForRx = readRegister(CONFIG) == CONFIG_REG_FOR_RX_MODE;
+    uint8_t readyForRx = readRegister(CONFIG) == _configRegForRxMode;
     return readyForRx;
 }
 
 void NRFLite::startSend(uint8_t toRadioId, void *data, uint8_t length, SendType sendType)
 {
     _usingInterrupts = 1;
+    if (_timestampHook) _timestampHook(*this, SEND_STARTED);
 
     // Ensure radio is in Standby-II mode and the TX buffer has room for the outgoing packet.
     startTx(toRadioId, sendType);
+    if (_listenBeforeTalkHook) _listenBeforeTalkHook(*this, SEND_STARTED);
 
     // Add data to the TX buffer, with or without an ACK request.
-    if (sendType == NO_ACK) { spiTransfer(WRITE_OPERATION, W_TX_PAYLOAD_NO_ACK, data, length); }
-    else                    { spiTransfer(WRITE_OPERATION, W_TX_PAYLOAD       , data, length); }
+    writeTxPayload(sendType, data, length);
 
     // It is up to the caller to determine if the packet was sent using 'whatHappened'.
 }
 
+void NRFLite::startTrace(TraceEntry entries[], uint8_t entryCount)
+{
+    _traceIndex = 0;
+    _traceIsFull = 0;
+    _traceEntryCount = entryCount;
+    _traceEntries = entries;
+    _traceRecorder = entryCount > 0 ? &recordTrace : NULL;
+}
+
+void NRFLite::stopTrace()
+{
+    _traceRecorder = NULL; // The entries are kept so they can still be printed.
+}
+
+void NRFLite::timestampIrq()
+{
+    if (!_timestamps) return;
+    _timestamps->IrqMicros = micros();
+    _timestamps->HasIrqMicros = 1;
+}
+
+void NRFLite::updateBeacon(void *data, uint8_t length)
+{
+    if (!_beaconHook) return;
+
+    _beacon->Data = data;
+    _beacon->Length = length;
+
+    if (_usingSeparateCeAndCsnPins)
+    {
+        loadBeacon();
+    }
+}
+
 void NRFLite::whatHappened(uint8_t &txOk, uint8_t &txFail, uint8_t &rxReady)
 {
     _usingInterrupts = 1;
 
-    uint8_t statusReg = readRegister(STATUS_NRF);
+    // Reset the IRQ pin by clearing the status flags that caused the interrupt.
+    uint8_t statusReg = clearStatusFlags(_BV(TX_DS) | _BV(MAX_RT) | _BV(RX_DR));
 
     txOk = (statusReg >> TX_DS) & 1;
     txFail = (statusReg >> MAX_RT) & 1;
     rxReady = (statusReg >> RX_DR) & 1;
 
-    // Clear status flags.
-    writeRegister(STATUS_NRF, _BV(TX_DS) | _BV(MAX_RT) | _BV(RX_DR));
+    if (_timestampHook) _timestampHook(*this, IRQ_HANDLED | (statusReg & (_BV(TX_DS) | _BV(RX_DR))));
+
+    if (_autoPowerHook && (txOk || txFail)) _autoPowerHook(*this, txOk ? TX_SENT : TX_FAILED);
 
     // Clear TX buffer if a packet could not be sent.
     if (txFail) spiTransfer(WRITE_OPERATION, FLUSH_TX, NULL, 0);
@@ -349,6 +804,166 @@ void NRFLite::whatHappened(uint8_t &txOk, uint8_t &txFail, uint8_t &rxReady)
 // Private //
 /////////////
 
+void NRFLite::adjustPower(NRFLite &radio, uint8_t event)
+{
+    if (event == TX_STARTED)
+    {
+        // Only destinations that ACK'd earlier packets have an entry, the rest use full power, as do broadcasts.
+        PowerEntry *entry = radio._txToGroup ? NULL : radio.findPowerEntry(radio._lastToRadioId);
+        radio.setPowerLevel(entry ? entry->Level : (uint8_t)POWER_0DBM);
+    }
+    else if (event == RX_STARTED)
+    {
+        radio.setPowerLevel(POWER_0DBM); // ACK packets must reach every radio that sends to us.
+    }
+    else if (radio._powerEntryCount)
+    {
+        radio.updatePowerLevel(event == TX_SENT);
+    }
+}
+
+uint8_t NRFLite::clearStatusFlags(uint8_t flags)
+{
+    // Writing 1 to a flag clears it, so write back only the flags that were set when the transaction started.
+    // A flag raised after that is left for the next check rather than lost.
+    spiBegin();
+    uint8_t statusReg = spiTransferByte(W_REGISTER | STATUS_NRF);
+    spiTransferByte(statusReg & flags);
+    if (_traceRecorder) _traceRecorder(*this, W_REGISTER | STATUS_NRF, statusReg, 1, statusReg & flags);
+    spiEnd();
+
+    return statusReg;
+}
+
+uint8_t NRFLite::completeBatchItems(BatchItem items[], uint8_t loaded[], uint8_t &loadedCount, SendType sendType)
+{
+    // Polling at a quarter of the retry time lets the next item be loaded before the radio finishes the current one.
+    // 16 attempts for each of 2 packets, with 4 polls per attempt, is the most a working radio needs.
+    static const uint8_t MAX_POLL_COUNT = 2 * 16 * 4;
+
+    uint8_t pollCount = MAX_POLL_COUNT;
+    uint8_t statusReg = readRegister(STATUS_NRF);
+
+    while (!(statusReg & (_BV(TX_DS) | _BV(MAX_RT))))
+    {
+        if (!pollCount--)
+        {
+            // The radio is not responding, so give up on the loaded items.
+            spiTransfer(WRITE_OPERATION, FLUSH_TX, NULL, 0);
+            while (loadedCount) items[loaded[--loadedCount]].Status = QUEUE_FAILED;
+            return 0;
+        }
+
+        delayMicroseconds(_txRetryMicros / 4);
+        statusReg = readRegister(STATUS_NRF);
+    }
+
+    // Clearing the flags also returns any raised since the last poll.
+    statusReg = clearStatusFlags(_BV(TX_DS) | _BV(MAX_RT));
+
+    uint8_t packetWasSent = statusReg & _BV(TX_DS);
+    uint8_t packetCouldNotBeSent = statusReg & _BV(MAX_RT);
+    uint8_t completedCount, sentCount;
+
+    if (packetCouldNotBeSent)
+    {
+        // The radio stops at the failed item, so a TX_DS means the item loaded before it was sent.
+        sentCount = packetWasSent && loadedCount > 1 ? 1 : 0;
+        completedCount = sentCount + 1;
+        spiTransfer(WRITE_OPERATION, FLUSH_TX, NULL, 0);
+    }
+    else
+    {
+        // With at most 2 items loaded, an empty TX buffer means both were sent, otherwise only the first was.
+        uint8_t txBufferIsEmpty = readRegister(FIFO_STATUS) & _BV(TX_EMPTY);
+        completedCount = txBufferIsEmpty ? loadedCount : 1;
+        sentCount = completedCount;
+
+        // The second item may have been sent after the flags were cleared, and its TX_DS must not be taken for
+        // the next items loaded.
+        if (completedCount > 1) writeRegister(STATUS_NRF, _BV(TX_DS));
+    }
+
+    for (uint8_t i = 0; i < completedCount; i++)
+    {
+        items[loaded[i]].Status = i < sentCount ? QUEUE_SENT : QUEUE_FAILED;
+    }
+
+    for (uint8_t i = completedCount; i < loadedCount; i++)
+    {
+        loaded[i - completedCount] = loaded[i];
+    }
+
+    loadedCount -= completedCount;
+
+    // Flushing after a failure also removed the item loaded after the failed one.
+    if (packetCouldNotBeSent && loadedCount)
+    {
+        BatchItem &item = items[loaded[0]];
+        writeTxPayload(sendType, item.Data, item.Length > 32 ? 32 : item.Length);
+    }
+
+    return sentCount;
+}
+
+void NRFLite::completeQueuedPacket(QueueStatuses status)
+{
+    if (_queueLoadedCount == 0) return;
+
+    _queue[_queueFirst].Status = status;
+    _queueFirst = (_queueFirst + 1) % _queueSize;
+    _queueCount--;
+    _queueLoadedCount--;
+}
+
+void NRFLite::endBeacon(NRFLite &radio, uint8_t)
+{
+    // Any other send or switching to RX mode ends beaconing, so the event doesn't matter.
+    radio._beaconHook = NULL;
+
+    if (radio._usingSeparateCeAndCsnPins)
+    {
+        // The reused payload stays in the TX buffer until it is flushed, and payload reuse must not be
+        // turned off while it is being sent.
+        while (micros() - radio._beacon->LastMicros < radio._txRetryMicros);
+        radio.spiTransfer(WRITE_OPERATION, FLUSH_TX, NULL, 0);
+        digitalWrite(radio._cePin, HIGH); // Standby-II mode so new packets are sent.
+    }
+}
+
+uint8_t NRFLite::endMessageRead(void *data, uint8_t messageLength, uint8_t length)
+{
+    uint8_t* intData = reinterpret_cast<uint8_t*>(data);
+
+    // The rest of the packet must be read even if it is the wrong length for the message, otherwise it remains in the RX buffer.
+    // Static payloads are padded so they only need to be long enough for the message.
+    uint8_t isExpectedLength = _staticPayloadLength ? length >= messageLength : length == messageLength;
+
+    for (uint8_t i = 0; i < length; ++i) {
+        uint8_t newData = spiTransferByte(NRF_NOP);
+        if (isExpectedLength && i < messageLength) intData[i] = newData;
+    }
+
+    spiEnd();
+
+    // Clear the data received flag if not using interrupts.
+    if (!_usingInterrupts) writeRegister(STATUS_NRF, _BV(RX_DR));
+    if (_timestampHook) _timestampHook(*this, RX_READ);
+    if (_rxBurstCount < 255) _rxBurstCount++;
+
+    return isExpectedLength;
+}
+
+NRFLite::PowerEntry *NRFLite::findPowerEntry(uint8_t radioId)
+{
+    for (uint8_t i = 0; i < _powerEntryCount; i++)
+    {
+        if (_powerEntries[i].IsUsed && _powerEntries[i].RadioId == radioId) return &_powerEntries[i];
+    }
+
+    return NULL;
+}
+
 uint8_t NRFLite::getPipeOfFirstRxPacket()
 {
     // The pipe number is bits 3, 2, and 1.  So B1110 masks them and we shift right by 1 to get the pipe number.
@@ -358,8 +973,40 @@ uint8_t NRFLite::getPipeOfFirstRxPacket()
     return (readRegister(STATUS_NRF) & 0b1110) >> 1;
 }
 
+NRFLite::PowerEntry &NRFLite::getPowerEntry(uint8_t radioId)
+{
+    PowerEntry *existingEntry = findPowerEntry(radioId);
+    if (existingEntry) return *existingEntry;
+
+    // New destinations replace the entries in turn and start at full power.
+    PowerEntry &entry = _powerEntries[_powerEntryToReplace];
+    _powerEntryToReplace = (_powerEntryToReplace + 1) % _powerEntryCount;
+
+    entry.RadioId = radioId;
+    entry.Level = POWER_0DBM;
+    entry.LowRetryCount = 0;
+    entry.IsUsed = 1;
+    return entry;
+}
+
+uint16_t NRFLite::getRandom(uint16_t limit)
+{
+    // Radios that collide must pick different delays, so rather than sharing the sketch's 'random' sequence, which
+    // is the same on every radio unless it is seeded, each radio uses its own, started from its id and the time.
+    if (!_randomState) _randomState = ((_savedRadioId << 8 | _savedRadioId) ^ micros()) | 1;
+
+    // 16 bit xorshift, which never returns to 0.
+    _randomState ^= _randomState << 7;
+    _randomState ^= _randomState >> 9;
+    _randomState ^= _randomState << 8;
+    return _randomState % limit;
+}
+
 uint8_t NRFLite::getRxPacketLength()
 {
+    // Static payloads all have the same length, so there is nothing to read.
+    if (_staticPayloadLength) return _staticPayloadLength;
+
     // Read the length of the first data packet sitting in the RX buffer.
     uint8_t dataLength;
     spiTransfer(READ_OPERATION, R_RX_PL_WID, &dataLength, 1);
@@ -409,7 +1056,7 @@ uint8_t NRFLite::initRadio(uint8_t radioId, Bitrates bitrate, uint8_t channel)
         writeRegister(RF_SETUP, 0b00001110);   // 2 Mbps, 0 dBm output power
         writeRegister(SETUP_RETR, 0b00011111); // 0001 =  500 uS between retries, 1111 = 15 retries
         _txRetryMicros = 600;                  // 100 uS more than the retry delay
-        _minRxTimeMicros = 1200;               // Required RX time for shared CE and CSN pin operation (just a time vs speed compromise determined by experimentation).
+        _minRxTimeMicros = 1200;               // Starting RX time for shared CE and CSN pin operation (just a time vs speed compromise determined by experimentation).
     }
     else if (bitrate == BITRATE1MBPS)
     {
@@ -426,19 +1073,42 @@ uint8_t NRFLite::initRadio(uint8_t radioId, Bitrates bitrate, uint8_t channel)
         _minRxTimeMicros = 5000;
     }
 
+    // Set the address width, 3 to 5 bytes.  SETUP_AW stores the width minus 2.
+    writeRegister(SETUP_AW, _addressWidth - 2);
+
+    _powerLevel = POWER_0DBM;
+    _retryDelaySteps = 0;
+
+    _rxWindowMicros = _minRxTimeMicros;
+    _lastRxCheckMicros = micros();
+    _rxBurstCount = 0;
+
     // Assign this radio's address to RX pipe 1.  When another radio sends us data, this is the address
     // it will use.  We use RX pipe 1 to store our address since the address in RX pipe 0 is reserved
     // for use with auto-acknowledgment (ACK) packets.
-    uint8_t address[5] = { ADDRESS_PREFIX[0], ADDRESS_PREFIX[1], ADDRESS_PREFIX[2], ADDRESS_PREFIX[3], radioId };
-    writeRegister(RX_ADDR_P1, &address, 5);
+    writeAddress(RX_ADDR_P1, radioId);
 
-    // Enable dynamically sized packets on the 2 RX pipes we use, 0 and 1.
-    // RX pipe address 1 is used to for normal packets from radios that send us data.
-    // RX pipe address 0 is used to for ACK packets from radios we transmit to.
-    writeRegister(DYNPD, _BV(DPL_P0) | _BV(DPL_P1));
+    if (_staticPayloadLength)
+    {
+        // Every packet on the 2 RX pipes we use, 0 and 1, has the same length so the packet control field
+        // doesn't carry one.  ACK packets are empty since ACK data packets require dynamically sized payloads.
+        writeRegister(RX_PW_P0, _staticPayloadLength);
+        writeRegister(RX_PW_P1, _staticPayloadLength);
+        writeRegister(DYNPD, 0);
+
+        // Enable TX support with or without an ACK request.
+        writeRegister(FEATURE, _BV(EN_DYN_ACK));
+    }
+    else
+    {
+        // Enable dynamically sized packets on the 2 RX pipes we use, 0 and 1.
+        // RX pipe address 1 is used to for normal packets from radios that send us data.
+        // RX pipe address 0 is used to for ACK packets from radios we transmit to.
+        writeRegister(DYNPD, _BV(DPL_P0) | _BV(DPL_P1));
 
-    // Enable dynamically sized payloads, ACK data packet payloads, and TX support with or without an ACK request.
-    writeRegister(FEATURE, _BV(EN_DPL) | _BV(EN_ACK_PAY) | _BV(EN_DYN_ACK));
+        // Enable dynamically sized payloads, ACK data packet payloads, and TX support with or without an ACK request.
+        writeRegister(FEATURE, _BV(EN_DPL) | _BV(EN_ACK_PAY) | _BV(EN_DYN_ACK));
+    }
 
     // Ensure RX and TX buffers are empty.  Each buffer can hold 3 packets.
     spiTransfer(WRITE_OPERATION, FLUSH_RX, NULL, 0);
@@ -451,29 +1121,233 @@ uint8_t NRFLite::initRadio(uint8_t radioId, Bitrates bitrate, uint8_t channel)
     return success;
 }
 
-void NRFLite::printRegister(const char name[], uint8_t reg)
+uint8_t NRFLite::isNewBroadcast(uint8_t sequence)
+{
+    // The distance is signed, so sequence numbers up to 127 after the newest one are newer and the rest are older,
+    // which keeps working when the sequence numbers wrap around.
+    int8_t distance = sequence - _newestBroadcastSequence;
+    uint8_t age = _newestBroadcastSequence - sequence;
+
+    if (_trackedBroadcasts && distance > 0)
+    {
+        _receivedBroadcasts = distance < 32 ? (_receivedBroadcasts << distance) | 1 : 1;
+        _trackedBroadcasts = distance < 32 - _trackedBroadcasts ? _trackedBroadcasts + distance : 32;
+        _newestBroadcastSequence = sequence;
+        _oldBroadcastSequence = sequence;
+        return 1;
+    }
+
+    if (_trackedBroadcasts && age <= MAX_REBROADCAST_AGE)
+    {
+        uint32_t bit = (uint32_t)1 << age;
+        if (_receivedBroadcasts & bit) return 0;
+        _receivedBroadcasts |= bit;
+        return 1;
+    }
+
+    if (_trackedBroadcasts)
+    {
+        // Rebroadcasts are recent, so an older sequence number is a late copy, or the broadcaster restarted and its
+        // sequence numbers started again from 0.  Copies repeat a sequence number while a restarted broadcaster counts
+        // up, so a restart is only assumed once 2 consecutive older sequence numbers arrive.  A late copy is dropped
+        // rather than resetting the tracking, which would let the next copies of recent broadcasts through again.
+        uint8_t broadcasterRestarted = sequence == (uint8_t)(_oldBroadcastSequence + 1);
+        _oldBroadcastSequence = sequence;
+        if (!broadcasterRestarted) return 0;
+    }
+
+    // Start tracking from the first broadcast received, or the first one taken to be after a restart.
+    _trackedBroadcasts = 1;
+    _newestBroadcastSequence = sequence;
+    _oldBroadcastSequence = sequence;
+    _receivedBroadcasts = 1;
+    return 1;
+}
+
+void NRFLite::loadBeacon()
+{
+    // Payload reuse must not be turned on or off while a packet is being sent, and the retry time is
+    // enough to send the largest packet.
+    while (micros() - _beacon->LastMicros < _txRetryMicros);
+
+    spiTransfer(WRITE_OPERATION, FLUSH_TX, NULL, 0);
+    writeTxPayload(NO_ACK, _beacon->Data, _beacon->Length);
+    spiTransfer(WRITE_OPERATION, REUSE_TX_PL, NULL, 0);
+}
+
+void NRFLite::loadQueue()
+{
+    while (_queueLoadedCount < MAX_LOADED_QUEUE_PACKETS && _queueLoadedCount < _queueCount)
+    {
+        QueuedPacket &packet = _queue[(_queueFirst + _queueLoadedCount) % _queueSize];
+
+        // Changing the TX address would also redirect the packets already loaded, so wait until they are sent.
+        if (_queueLoadedCount && packet.ToRadioId != _queue[_queueFirst].ToRadioId) return;
+
+        // Ensure radio is in Standby-II mode, then add data to the TX buffer.
+        startTx(packet.ToRadioId, packet.Type);
+        writeTxPayload(packet.Type, packet.Data, packet.Length);
+
+        packet.Status = QUEUE_SENDING;
+        _queueLoadedCount++;
+    }
+}
+
+void NRFLite::printAddress(Print &output, const __FlashStringHelper *name, const uint8_t address[5])
 {
-    debug(name); debug(' ');
+    output.print(name); output.print(' ');
+
+    for (uint8_t i = 0; i < 4; i++) {
+        output.print(address[i]); output.print(',');
+    }
+
+    output.println(address[4]);
+}
+
+void NRFLite::printRegister(Print &output, const __FlashStringHelper *name, uint8_t reg)
+{
+    output.print(name); output.print(' ');
 
     for (int8_t i = 7; i >= 0; i--) {
-        debug((reg >> i) & 1);
+        output.print((reg >> i) & 1);
+    }
+
+    output.println();
+}
+
+void NRFLite::recordTimestamp(NRFLite &radio, uint8_t event)
+{
+    Timestamps &timestamps = *radio._timestamps;
+
+    if (event == SEND_STARTED)
+    {
+        timestamps.TxStartMicros = micros();
+    }
+    else if (event == TX_SENT)
+    {
+        timestamps.TxDoneMicros = micros();
+    }
+    else if (event == RX_READ)
+    {
+        timestamps.HasRxMicros = 0;
+    }
+    else if (event & IRQ_HANDLED)
+    {
+        // The time of the interrupt is kept while RX_DR is asserted, for the packets found by 'hasDataISR'.
+        // The interrupt handler could change the multi-byte time part way through reading or replacing it,
+        // so prevent that.
+        noInterrupts();
+        uint32_t eventMicros = timestamps.HasIrqMicros ? timestamps.IrqMicros : micros();
+        timestamps.IrqMicros = eventMicros;
+        timestamps.HasIrqMicros = (event >> RX_DR) & 1;
+        interrupts();
+
+        if (event & _BV(TX_DS)) timestamps.TxDoneMicros = eventMicros;
+        if (event & _BV(RX_DR)) { timestamps.RxMicros = eventMicros; timestamps.HasRxMicros = 1; }
     }
+    else if (!timestamps.HasRxMicros)
+    {
+        // A packet was found.  With interrupts it was received by the time of the RX_DR interrupt, if it was recorded.
+        // The interrupt handler could change the multi-byte time part way through reading it, so prevent that.
+        noInterrupts();
+        timestamps.RxMicros = event == RX_FOUND_ISR && timestamps.HasIrqMicros ? timestamps.IrqMicros : micros();
+        interrupts();
+        timestamps.HasRxMicros = 1;
+    }
+}
 
-    debugln();
+void NRFLite::recordTrace(NRFLite &radio, uint8_t command, uint8_t status, uint8_t length, uint8_t data)
+{
+    // Called with interrupts disabled during the SPI transaction, so an interrupt using the radio can't interleave entries.
+    TraceEntry &entry = radio._traceEntries[radio._traceIndex];
+    entry.Micros = micros();
+    entry.Command = command;
+    entry.Status = status;
+    entry.Length = length;
+    entry.Data = data;
+
+    if (++radio._traceIndex == radio._traceEntryCount)
+    {
+        radio._traceIndex = 0;
+        radio._traceIsFull = 1;
+    }
 }
 
-void NRFLite::startTx(uint8_t toRadioId, SendType sendType)
+void NRFLite::sendBroadcast(uint8_t groupId, uint8_t sequence, void *data, uint8_t length, uint8_t copies)
 {
-    if (toRadioId != _lastToRadioId)
+    _usingInterrupts = 0;
+
+    while (copies--)
     {
+        // Ensure radio is in Standby-II mode and the TX buffer has room, so the copies are sent back to back.
+        startTx(groupId, NO_ACK, 1);
+
+        // Add the sequence number followed by the data to the TX buffer.
+        writeTxPayload(NO_ACK, data, length, sequence);
+    }
+}
+
+uint8_t NRFLite::sendPacket(uint8_t toRadioId, int16_t header, void *data, uint8_t length, SendType sendType)
+{
+    _usingInterrupts = 0;
+    if (_timestampHook) _timestampHook(*this, SEND_STARTED);
+
+    // Clear any previously asserted TX success or max retries flags.
+    clearStatusFlags(_BV(TX_DS) | _BV(MAX_RT));
+
+    // Ensure radio is in Standby-II mode and the TX buffer has room for the outgoing packet.
+    startTx(toRadioId, sendType);
+    if (_listenBeforeTalkHook) _listenBeforeTalkHook(*this, SEND_STARTED);
+
+    // Add the header, if any, and data to the TX buffer, with or without an ACK request.
+    writeTxPayload(sendType, data, length, header);
+
+    // Wait for the TX buffer to be empty.
+    uint8_t packetWasSent = waitForTx(_usingInterrupts);
+    if (_timestampHook && packetWasSent) _timestampHook(*this, TX_SENT);
+    if (_autoPowerHook) _autoPowerHook(*this, packetWasSent ? TX_SENT : TX_FAILED);
+    return packetWasSent;
+}
+
+void NRFLite::setPowerLevel(uint8_t level)
+{
+    if (level == _powerLevel) return;
+    _powerLevel = level;
+
+    // RF_SETUP holds both the bitrate and the output power.
+    uint8_t bitrateBits = _savedBitrate == BITRATE2MBPS ? _BV(RF_DR_HIGH) : _savedBitrate == BITRATE250KBPS ? _BV(RF_DR_LOW) : 0;
+    writeRegister(RF_SETUP, bitrateBits | (level << RF_PWR_LOW));
+}
+
+void NRFLite::setRetryDelay(uint8_t extraSteps)
+{
+    // Radios whose packets collide keep colliding on every retry when they wait the same time between retries,
+    // so a random number of 250 uS steps can be added to the retry delay set by 'initRadio'.
+    uint8_t retryDelay = (_savedBitrate == BITRATE250KBPS ? 0b0101 : 0b0001) + extraSteps;
+    writeRegister(SETUP_RETR, (retryDelay << ARD) | 0b1111);
+    _txRetryMicros = (retryDelay + 1) * 250 + 100; // 100 uS more than the retry delay
+    _retryDelaySteps = extraSteps;
+}
+
+void NRFLite::startTx(uint8_t toRadioId, SendType sendType, uint8_t toGroup)
+{
+    if (_beaconHook) _beaconHook(*this, TX_STARTED);
+
+    if (toRadioId != _lastToRadioId || toGroup != _txToGroup)
+    {
+        // Broadcasts still in the TX buffer must be sent before the address changes.
+        static const uint8_t ALL_PACKETS_SENT = 0;
+        if (_txToGroup) waitForTx(ALL_PACKETS_SENT);
+
         _lastToRadioId = toRadioId;
+        _txToGroup = toGroup;
 
-        // TX pipe address sets the destination radio.
-        uint8_t address[5] = { ADDRESS_PREFIX[0], ADDRESS_PREFIX[1], ADDRESS_PREFIX[2], ADDRESS_PREFIX[3], toRadioId };
-        writeRegister(TX_ADDR, &address, 5);
+        // TX pipe address sets the destination radio or group.
+        writeAddress(TX_ADDR, toRadioId, toGroup);
 
         // RX pipe 0 needs the same address in order to receive ACK packets from the destination radio.
-        writeRegister(RX_ADDR_P0, &address, 5);
+        // Broadcasts are never acknowledged.
+        if (!toGroup) writeAddress(RX_ADDR_P0, toRadioId);
     }
 
     // We enable several features so if none are on, the radio must have lost its configuration.
@@ -484,8 +1358,11 @@ void NRFLite::startTx(uint8_t toRadioId, SendType sendType)
         initRadio(_savedRadioId, _savedBitrate, _savedChannel);
     }
 
+    _lastSendType = sendType;
+    if (_autoPowerHook) _autoPowerHook(*this, TX_STARTED);
+
     // Ensure radio is configured for TX.
-    uint8_t readyForTx = readRegister(CONFIG) == (CONFIG_REG_FOR_RX_MODE & ~_BV(PRIM_RX));
+    uint8_t readyForTx = readRegister(CONFIG) == (_configRegForRxMode & ~_BV(PRIM_RX));
     if (!readyForTx)
     {
         // Mode transition: RX -> Standby-I or PowerDown -> Standby-I -> Standby-II.
@@ -503,7 +1380,7 @@ void NRFLite::startTx(uint8_t toRadioId, SendType sendType)
             powerDown(); // PowerDown mode.
         }
 
-        writeRegister(CONFIG, CONFIG_REG_FOR_RX_MODE & ~_BV(PRIM_RX)); // TX configuration, Power on, then Standby-I mode.
+        writeRegister(CONFIG, _configRegForRxMode & ~_BV(PRIM_RX)); // TX configuration, Power on, then Standby-I mode.
         digitalWrite(_cePin, HIGH);                                    // Standby-II mode.
         delay(POWERDOWN_TO_RXTX_MODE_MILLIS);                          // Power on delay.
     }
@@ -528,6 +1405,111 @@ void NRFLite::startTx(uint8_t toRadioId, SendType sendType)
     }
 }
 
+void NRFLite::updatePowerLevel(uint8_t packetWasSent)
+{
+    // NO_ACK packets are never retried so they say nothing about the link.
+    if (_lastSendType == NO_ACK) return;
+
+    PowerEntry &entry = getPowerEntry(_lastToRadioId);
+    uint8_t retryCount = readRegister(OBSERVE_TX) & 0b1111; // ARC_CNT, retries needed by the last packet.
+
+    if (!packetWasSent)
+    {
+        entry.Level = POWER_0DBM;
+        entry.LowRetryCount = 0;
+    }
+    else if (retryCount >= AUTO_POWER_HIGH_RETRIES)
+    {
+        if (entry.Level < POWER_0DBM) entry.Level++;
+        entry.LowRetryCount = 0;
+    }
+    else if (retryCount <= AUTO_POWER_LOW_RETRIES)
+    {
+        if (++entry.LowRetryCount >= AUTO_POWER_LOWER_AFTER)
+        {
+            if (entry.Level > POWER_MINUS_18DBM) entry.Level--;
+            entry.LowRetryCount = 0;
+        }
+    }
+    else
+    {
+        entry.LowRetryCount = 0;
+    }
+}
+
+void NRFLite::updateRxWindow()
+{
+    // The RX buffer is empty, so adjust the RX time using the number of packets read since it was last empty.
+    // Reading a full buffer means packets were probably dropped so the time is halved, while finding it empty
+    // means the check was wasted so the time grows.
+    if (!_usingAdaptiveRxWindow)
+    {
+        _rxBurstCount = 0;
+        return;
+    }
+
+    uint16_t minRxWindowMicros = _minRxTimeMicros / 2;
+    uint16_t maxRxWindowMicros = _minRxTimeMicros * 4;
+
+    if (_rxBurstCount >= 3)       _rxWindowMicros /= 2;
+    else if (_rxBurstCount == 2)  _rxWindowMicros -= _rxWindowMicros / 4;
+    else if (_rxBurstCount == 0)  _rxWindowMicros += _rxWindowMicros / 4;
+
+    if (_rxWindowMicros < minRxWindowMicros) _rxWindowMicros = minRxWindowMicros;
+    if (_rxWindowMicros > maxRxWindowMicros) _rxWindowMicros = maxRxWindowMicros;
+
+    _rxBurstCount = 0;
+}
+
+void NRFLite::waitForClearChannel(NRFLite &radio, uint8_t)
+{
+    // The radio can only listen while it isn't sending, so packets added behind others are sent without listening.
+    uint8_t txBufferIsEmpty = radio.readRegister(FIFO_STATUS) & _BV(TX_EMPTY);
+    if (!txBufferIsEmpty) return;
+
+    // RPD is only measured in RX mode, so RX pipe 0 is turned off while listening.  Otherwise a packet sent
+    // to the destination radio would also be received and acknowledged by this radio.
+    radio.writeRegister(EN_RXADDR, _BV(ERX_P1));
+
+    uint8_t channelWasBusy = 0;
+
+    for (uint8_t attempt = 0; attempt < LBT_MAX_ATTEMPTS; attempt++)
+    {
+        // Mode transition: Standby-II -> RX -> Standby-I -> Standby-II.  With shared CE and CSN pins the radio
+        // leaves RX mode when CSN goes LOW to read RPD, which keeps its value after leaving RX mode.
+        if (radio._usingSeparateCeAndCsnPins) digitalWrite(radio._cePin, LOW);
+        radio.writeRegister(CONFIG, radio._configRegForRxMode);
+        if (radio._usingSeparateCeAndCsnPins) digitalWrite(radio._cePin, HIGH);
+        delayMicroseconds(170); // 130 uS to enter RX mode + 40 uS to measure the received power.
+        if (radio._usingSeparateCeAndCsnPins) digitalWrite(radio._cePin, LOW);
+
+        uint8_t channelIsBusy = radio.readRegister(RPD);
+
+        radio.writeRegister(CONFIG, radio._configRegForRxMode & ~_BV(PRIM_RX));
+        if (radio._usingSeparateCeAndCsnPins) digitalWrite(radio._cePin, HIGH);
+
+        if (!channelIsBusy) break;
+        channelWasBusy = 1;
+
+        // The packet is sent after the last attempt whether or not the channel is busy, so there's no point waiting.
+        if (attempt == LBT_MAX_ATTEMPTS - 1) break;
+
+        // Radios that found the channel busy at the same time pick different delays, and the range doubles each
+        // attempt.  The retry time is enough for a packet and its ACK.  The delay can reach about 19 mS, and
+        // 'delayMicroseconds' is only accurate up to 16383 uS on AVR, so whole milliseconds use 'delay'.
+        uint16_t backoffMicros = radio.getRandom(radio._txRetryMicros << attempt);
+        delay(backoffMicros / 1000);
+        delayMicroseconds(backoffMicros % 1000);
+    }
+
+    radio.writeRegister(EN_RXADDR, _BV(ERX_P0) | _BV(ERX_P1));
+
+    // The hardware retries don't listen first, so once the channel is found busy, and radios are likely to collide,
+    // use a new random retry delay to keep them from repeating a collision.  'setListenBeforeTalk' restores the
+    // retry delay set by 'initRadio'.
+    if (channelWasBusy) radio.setRetryDelay(radio.getRandom(4));
+}
+
 uint8_t NRFLite::waitForTx(uint8_t usingInterrupts)
 {
     // TX buffer holds 3 packets, 15 retries, retry wait time is 1/2 the time needed
@@ -566,24 +1548,73 @@ uint8_t NRFLite::waitForTx(uint8_t usingInterrupts)
             }
         }
         
-        delayMicroseconds(_txRetryMicros); // Wait for the radio to try sending again.
+        if (_timestampHook && _usingSeparateCeAndCsnPins && !usingInterrupts)
+        {
+            // Check more often so the time the packet was sent is known more precisely.  With shared CE and CSN pins
+            // every check stops the radio from sending, so it isn't done then.
+            for (uint16_t waitMicros = 0; waitMicros < _txRetryMicros; waitMicros += TIMESTAMP_POLL_MICROS)
+            {
+                delayMicroseconds(TIMESTAMP_POLL_MICROS);
+                if (readRegister(STATUS_NRF) & (_BV(TX_DS) | _BV(MAX_RT))) break;
+            }
+        }
+        else
+        {
+            delayMicroseconds(_txRetryMicros); // Wait for the radio to try sending again.
+        }
     }
 
     return 0;
 }
 
+void NRFLite::writeAddress(uint8_t regName, uint8_t radioId, uint8_t isGroupAddress)
+{
+    // Addresses are written least significant byte first, and the radio id is the most significant byte.
+    // Shorter addresses drop the least significant bytes of the prefix.  Group addresses invert the byte
+    // next to the id, which every address width keeps, so they never match a radio's address.
+    uint8_t address[5] = { _addressPrefix[0], _addressPrefix[1], _addressPrefix[2], _addressPrefix[3], radioId };
+    if (isGroupAddress) address[3] = ~address[3];
+    writeRegister(regName, &address[5 - _addressWidth], _addressWidth);
+}
+
+void NRFLite::writeTxPayload(SendType sendType, void *data, uint8_t length, int16_t header)
+{
+    uint8_t command = sendType == NO_ACK ? W_TX_PAYLOAD_NO_ACK : W_TX_PAYLOAD;
+
+    if (!_staticPayloadLength && header == NO_HEADER)
+    {
+        spiTransfer(WRITE_OPERATION, command, data, length);
+        return;
+    }
+
+    // A header byte is sent before the data in the same SPI transaction, so the packet never needs to be assembled
+    // in a separate buffer.  Static payloads must be exactly the configured length, so pad with zeros or truncate,
+    // and dynamic payloads are truncated to the 32 byte maximum.
+    uint8_t* intData = reinterpret_cast<uint8_t*>(data);
+    uint8_t headerLength = header == NO_HEADER ? 0 : 1;
+    uint8_t packetLength = _staticPayloadLength;
+    if (!packetLength) packetLength = length < 32 - headerLength ? length + headerLength : 32;
+
+    spiBegin();
+    uint8_t statusReg = spiTransferByte(command);
+    if (headerLength) spiTransferByte(header);
+    for (uint8_t i = 0; i + headerLength < packetLength; ++i) spiTransferByte(i < length ? intData[i] : 0);
+    if (_traceRecorder) _traceRecorder(*this, command, statusReg, packetLength, headerLength ? header : length ? intData[0] : 0);
+    spiEnd();
+}
+
 // Register methods
 
 uint8_t NRFLite::readRegister(uint8_t regName)
 {
-    uint8_t data;
+    uint8_t data = 0;
     readRegister(regName, &data, 1);
     return data;
 }
 
-void NRFLite::readRegister(uint8_t regName, void *data, uint8_t length)
+uint8_t NRFLite::readRegister(uint8_t regName, void *data, uint8_t length)
 {
-    spiTransfer(READ_OPERATION, (R_REGISTER | (REGISTER_MASK & regName)), data, length);
+    return spiTransfer(READ_OPERATION, (R_REGISTER | (REGISTER_MASK & regName)), data, length);
 }
 
 void NRFLite::writeRegister(uint8_t regName, uint8_t data)
@@ -598,51 +1629,74 @@ void NRFLite::writeRegister(uint8_t regName, void *data, uint8_t length)
 
 // SPI methods
 
-void NRFLite::spiTransfer(SpiTransferType transferType, uint8_t regName, void *data, uint8_t length)
+uint8_t NRFLite::spiTransfer(SpiTransferType transferType, uint8_t regName, void *data, uint8_t length)
 {
     uint8_t* intData = reinterpret_cast<uint8_t*>(data);
 
+    spiBegin();
+
+    // The radio always responds to the command byte with its STATUS register.
+    uint8_t statusReg = spiTransferByte(regName);
+    for (uint8_t i = 0; i < length; ++i) {
+        uint8_t newData = spiTransferByte(intData[i]);
+        if (transferType == READ_OPERATION) intData[i] = newData;
+    }
+
+    if (_traceRecorder) _traceRecorder(*this, regName, statusReg, length, length ? intData[0] : 0);
+
+    spiEnd();
+
+    return statusReg;
+}
+
+void NRFLite::spiBegin()
+{
     noInterrupts(); // Prevent an interrupt from interferring with the communication.
 
     if (_useTwoPinSpiTransfer)
     {
         #if defined(__AVR__)
             // Signal radio to listen to SPI and allow the capacitor on CSN to discharge (CSN reaches LOW state).
-            static const uint16_t CSN_DISCHARGE_MICROS = 500;
             digitalWrite(_csnPin, LOW);
             delayMicroseconds(CSN_DISCHARGE_MICROS);
+        #endif
+    }
+    else
+    {
+        digitalWrite(_csnPin, LOW); // Signal radio to listen to SPI.
 
-            twoPinTransfer(regName);
-            for (uint8_t i = 0; i < length; ++i) {
-                uint8_t newData = twoPinTransfer(intData[i]);
-                if (transferType == READ_OPERATION) intData[i] = newData;
-            }
+        #if !defined(__AVR_ATtiny45__) && !defined(__AVR_ATtiny85__) && !defined(__AVR_ATtiny44__) && !defined(__AVR_ATtiny84__)
+            SPI.beginTransaction(SPISettings(NRF_SPICLOCK, MSBFIRST, SPI_MODE0));
+        #endif
+    }
+}
 
+uint8_t NRFLite::spiTransferByte(uint8_t data)
+{
+    #if defined(__AVR__)
+        if (_useTwoPinSpiTransfer) return twoPinTransfer(data);
+    #endif
+
+    #if defined(__AVR_ATtiny45__) || defined(__AVR_ATtiny85__) || defined(__AVR_ATtiny44__) || defined(__AVR_ATtiny84__)
+        return usiTransfer(data);  // ATtiny transfer with USI.
+    #else
+        return SPI.transfer(data); // Transfer with the Arduino SPI library.
+    #endif
+}
+
+void NRFLite::spiEnd()
+{
+    if (_useTwoPinSpiTransfer)
+    {
+        #if defined(__AVR__)
             // Signal radio to stop listening to SPI and allow the capacitor to recharge.
             digitalWrite(_csnPin, HIGH);
             delayMicroseconds(CSN_DISCHARGE_MICROS);
-	    #endif
+        #endif
     }
     else
     {
-        digitalWrite(_csnPin, LOW); // Signal radio to listen to SPI.
-
-        #if defined(__AVR_ATtiny45__) || defined(__AVR_ATtiny85__) || defined(__AVR_ATtiny44__) || defined(__AVR_ATtiny84__)
-            // ATtiny transfer with USI.
-            usiTransfer(regName);
-            for (uint8_t i = 0; i < length; ++i) {
-                uint8_t newData = usiTransfer(intData[i]);
-                if (transferType == READ_OPERATION) intData[i] = newData;
-            }
-        #else
-            // Transfer with the Arduino SPI library.
-            static const uint32_t NRF_SPICLOCK = 4000000;
-            SPI.beginTransaction(SPISettings(NRF_SPICLOCK, MSBFIRST, SPI_MODE0));
-            SPI.transfer(regName);
-            for (uint8_t i = 0; i < length; ++i) {
-                uint8_t newData = SPI.transfer(intData[i]);
-                if (transferType == READ_OPERATION) intData[i] = newData;
-            }
+        #if !defined(__AVR_ATtiny45__) && !defined(__AVR_ATtiny85__) && !defined(__AVR_ATtiny44__) && !defined(__AVR_ATtiny84__)
             SPI.endTransaction();
         #endif
 
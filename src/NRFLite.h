@@ -20,19 +20,45 @@ class NRFLite {
 
     enum Bitrates : uint8_t { BITRATE2MBPS, BITRATE1MBPS, BITRATE250KBPS };
     enum SendType : uint8_t { REQUIRE_ACK, NO_ACK };
+    enum AddressWidths : uint8_t { ADDRESS_WIDTH_3 = 3, ADDRESS_WIDTH_4 = 4, ADDRESS_WIDTH_5 = 5 };
+    enum CrcLengths : uint8_t { CRC_1_BYTE = 1, CRC_2_BYTES = 2 };
+    enum PowerLevels : uint8_t { POWER_MINUS_18DBM, POWER_MINUS_12DBM, POWER_MINUS_6DBM, POWER_0DBM };
 
     static const uint8_t MAX_NRF_CHANNEL = 125; // Maximum channel number.
 
+    struct RegisterSnapshot
+    {
+        uint8_t Config, EnAa, EnRxAddr, SetupAw, SetupRetr, RfCh, RfSetup, Status, ObserveTx, Rpd;
+        uint8_t RxPwP0, RxPwP1, FifoStatus, Dynpd, Feature;
+        uint8_t TxAddr[5], RxAddrP0[5], RxAddrP1[5];
+        uint8_t HasRpd; // Set if Rpd was read, otherwise it is 0 and not printed.
+    };
+
+    struct TraceEntry
+    {
+        uint32_t Micros;  // Time the SPI transaction completed.
+        uint8_t Command;  // SPI command, e.g. R_REGISTER | FIFO_STATUS.
+        uint8_t Status;   // STATUS register returned by the radio with the command.
+        uint8_t Length;   // Number of data bytes transferred after the command.
+        uint8_t Data;     // First data byte read or written, 0 if there were none.
+    };
+
     // Methods for receivers and transmitters.
-    // init         = Turns the radio on and puts it into receiving mode.  Returns 0 if it cannot communicate with the radio.
-    //                Channel can be 0-125 and sets the exact frequency of the radio between 2400 - 2525 MHz.
-    // initTwoPin   = Same as init but with multiplexed MOSI/MISO and CE/CSN/SCK pins (only works on AVR architectures).
-    //                Follow the 2-pin hookup schematic on https://github.com/dparson55/NRFLite
-    // readData     = Loads a received data packet or acknowledgment data packet into the specified data parameter.
-    // powerDown    = Power down the radio.  Turn the radio back on by calling one of the 'hasData' or 'send' methods.
-    // printDetails = Prints many of the radio registers.  Requires a serial object in the constructor, e.g. NRFLite _radio(Serial);
-    // scanChannel  = Returns a number between 0 and  measurementCount to indicate the strength of any existing signal on a channel.
-    //                Radio communication will work best on channels with no existing signals, meaning a 0 is returned.
+    // init          = Turns the radio on and puts it into receiving mode.  Returns 0 if it cannot communicate with the radio.
+    //                 Channel can be 0-125 and sets the exact frequency of the radio between 2400 - 2525 MHz.
+    // initTwoPin    = Same as init but with multiplexed MOSI/MISO and CE/CSN/SCK pins (only works on AVR architectures).
+    //                 Follow the 2-pin hookup schematic on https://github.com/dparson55/NRFLite
+    // readData      = Loads a received data packet or acknowledgment data packet into the specified data parameter.
+    // powerDown     = Power down the radio.  Turn the radio back on by calling one of the 'hasData' or 'send' methods.
+    // printDetails  = Prints many of the radio registers.  Requires a serial object in the constructor, e.g. NRFLite _radio(Serial);
+    // readSnapshot  = Copies the radio registers into a RegisterSnapshot without using any heap memory.  Each register needs
+    //                 its own SPI transaction since the radio doesn't advance to the next register during a read, so this
+    //                 uses 16 transactions, with STATUS taken from the first one.  RPD is only read, using a 17th
+    //                 transaction, when includeRpd is set, since it is only meaningful in RX mode.
+    // printSnapshot = Prints a RegisterSnapshot to any Print object, e.g. NRFLite::printSnapshot(Serial, snapshot);
+    //                 RPD is only printed if it was read.
+    // scanChannel   = Returns a number between 0 and  measurementCount to indicate the strength of any existing signal on a channel.
+    //                 Radio communication will work best on channels with no existing signals, meaning a 0 is returned.
     uint8_t init(uint8_t radioId, uint8_t cePin, uint8_t csnPin, Bitrates bitrate = BITRATE2MBPS, uint8_t channel = 100, uint8_t callSpiBegin = 1);
 #if defined(__AVR__)
     uint8_t initTwoPin(uint8_t radioId, uint8_t momiPin, uint8_t sckPin, Bitrates bitrate = BITRATE2MBPS, uint8_t channel = 100);
@@ -40,28 +66,184 @@ class NRFLite {
     void readData(void *data);
     void powerDown();
     void printDetails();
+    void readSnapshot(RegisterSnapshot &snapshot, uint8_t includeRpd = 0);
+    static void printSnapshot(Print &output, const RegisterSnapshot &snapshot);
     uint8_t scanChannel(uint8_t channel, uint8_t measurementCount = 255);
 
+    // Methods for changing the over-the-air packet format.
+    // setPacketFormat = Must be called before 'init'.  All radios that talk to each other need the same format.
+    //                   The default is 5 byte addresses, 1 byte CRC, and dynamic payload lengths.  Shorter addresses
+    //                   and CRC reduce the airtime of every packet and ACK, at the cost of more false packets from noise.
+    //                   A non-zero staticPayloadLength saves reading the length of every received packet from the radio.
+    //                   'send' pads or truncates data to that length, 'hasData' always returns it, and ACK data cannot be used.
+    //                   Typed messages must be shorter than staticPayloadLength since the message id uses 1 byte, longer
+    //                   ones are truncated the same way and discarded by the receiver.  Broadcasts are truncated likewise.
+    // setAddressPrefix = Must be called before 'init'.  Sets the first 4 bytes of every address, the last byte is the
+    //                    radio id.  Radios only talk to radios using the same prefix, so networks that share a channel
+    //                    can use different prefixes.  Shorter addresses use the last 2 or 3 bytes.  The default is 1, 2, 3, 4.
+    void setPacketFormat(AddressWidths addressWidth, CrcLengths crcLength, uint8_t staticPayloadLength = 0);
+    void setAddressPrefix(const uint8_t prefix[4]);
+
+    // Methods for tracing SPI communication with the radio.
+    // startTrace = Records every SPI transaction into the provided array, overwriting the oldest entries once it is full.
+    //              Tracing is off by default and only costs a pointer check per transaction when off, and sketches
+    //              that never call this don't include the code that records entries.
+    // stopTrace  = Stops recording.  The recorded entries remain in the array.
+    // printTrace = Prints the recorded entries, oldest first, as 'micros,command,status,length,data' lines that
+    //              can be decoded with extras/trace_analyzer.py.
+    void startTrace(TraceEntry entries[], uint8_t entryCount);
+    void stopTrace();
+    void printTrace(Print &output);
+
+    // Methods for measuring latency.
+    // setTimestamps    = Starts recording micros() times in the Timestamps provided by the calling program, so only radios
+    //                    that use this feature use memory for it.  The times are when 'send', send<T>, or 'startSend'
+    //                    starts, when the radio reports the packet was sent (TX_DS), and when a received packet is found.
+    //                    While recording, 'send' checks the radio every TIMESTAMP_POLL_MICROS rather than once per retry
+    //                    time, so the TX_DS time is more precise.  With shared CE and CSN pins every check stops the radio
+    //                    from sending, so 'send' still checks once per retry time and the TX_DS time is only accurate to
+    //                    the retry time.  NULL stops recording, which is the default.
+    // timestampIrq     = Call from the IRQ interrupt handler to use the time of the interrupt for the next 'whatHappened'
+    //                    or 'hasDataISR', rather than the time they are called.
+    // getClockOffset   = Estimates how far the micros() clock of another radio is ahead of this one, from a local send
+    //                    time, the other radio's receive time of that packet, and the local time its ACK was received.
+    //                    Half the round-trip time is assumed for each direction.  The one-way latency of a later packet is
+    //                    then Timestamps.RxMicros - sendMicros - offset, when the sender includes its send time and offset.
+    // addLatency       = Adds a latency sample to a LatencyStats, which can be reset by assigning {}.
+    // printLatency     = Prints the count, minimum, mean, maximum, and jitter of a LatencyStats followed by its histogram.
+    static const uint8_t TIMESTAMP_POLL_MICROS = 40;
+    static const uint8_t LATENCY_BUCKETS = 12;
+
+    struct LatencyStats
+    {
+        uint32_t Count, MinMicros, MaxMicros;
+        uint64_t TotalMicros;
+        uint32_t JitterMicros;              // Smoothed difference between consecutive samples, as in RFC 3550.
+        uint32_t LastMicros;
+        uint16_t Buckets[LATENCY_BUCKETS];  // Bucket 0 counts samples under 128 uS, and each bucket after it
+    };                                      // counts samples under twice the limit of the one before.
+
+    struct Timestamps
+    {
+        uint32_t TxStartMicros;          // Time the last send started.
+        uint32_t TxDoneMicros;           // Time the last packet was reported as sent by 'send' or 'whatHappened'.  Minus
+                                         // TxStartMicros this is the round-trip time of the packet and its ACK, including
+                                         // loading it into the radio.
+        uint32_t RxMicros;               // Time the packet last returned by 'hasData' was received.  Without interrupts this
+                                         // is when 'hasData' first found it.  With interrupts it is the time of the last RX_DR
+                                         // interrupt seen by 'whatHappened', or recorded by 'timestampIrq', so packets read
+                                         // after the same interrupt share it.
+        uint8_t HasRxMicros;             // Cleared once a packet is read so the next one found gets its own time.
+        volatile uint8_t HasIrqMicros;   // The IRQ time is written by the interrupt handler, so it is volatile, and is
+        volatile uint32_t IrqMicros;     // kept while RX_DR is asserted.
+    };
+
+    void setTimestamps(Timestamps *timestamps);
+    void timestampIrq();
+    static int32_t getClockOffset(uint32_t sendMicros, uint32_t remoteRxMicros, uint32_t ackMicros);
+    static void addLatency(LatencyStats &stats, uint32_t latencyMicros);
+    static void printLatency(Print &output, const LatencyStats &stats);
+
     // Methods for transmitters.
-    // send       = Puts the radio into TX mode and sends a data packet and waits for success or failure.
-    //              The default REQUIRE_ACK sendType causes the radio to attempt sending the packet up to 16 times.
-    //              If successful a 1 is returned.  Optionally the NO_ACK sendType can be used to transmit the packet
-    //              a single time without asking the receiver to send back an acknowledgement (ACK) packet.
-    // hasAckData = Checks to see if an acknowledgement data (ACK data) packet was provided by the receiver
-    //              and returns its length.
+    // send                = Puts the radio into TX mode and sends a data packet and waits for success or failure.
+    //                       The default REQUIRE_ACK sendType causes the radio to attempt sending the packet up to 16 times.
+    //                       If successful a 1 is returned.  Optionally the NO_ACK sendType can be used to transmit the packet
+    //                       a single time without asking the receiver to send back an acknowledgement (ACK) packet.
+    // hasAckData          = Checks to see if an acknowledgement data (ACK data) packet was provided by the receiver
+    //                       and returns its length.
+    // setListenBeforeTalk = When enabled, the radio listens for another signal on the channel before each 'send' or
+    //                       'startSend' packet that is loaded into an empty TX buffer, and waits a random time that doubles
+    //                       with each attempt while the channel is busy.  The packet is sent anyway after LBT_MAX_ATTEMPTS,
+    //                       and finding the channel busy picks a new random retry delay, which is used until this is
+    //                       disabled.  Listening takes about 200 uS, so this helps when many radios share a channel.
+    //                       Beacons, broadcasts, queued packets, and batches don't listen.  Disabled by default.
+    static const uint8_t LBT_MAX_ATTEMPTS = 5;
     uint8_t send(uint8_t toRadioId, void *data, uint8_t length, SendType sendType = REQUIRE_ACK);
     uint8_t hasAckData();
+    void setListenBeforeTalk(uint8_t enabled);
+
+    // Methods for broadcasting to a group of radios.
+    // Broadcast packets use a group address and NO_ACK, so one packet reaches every radio in the group without any ACK
+    // packets.  To make up for the lack of retries each packet is sent several times back to back, and receivers drop
+    // the extra copies using a sequence number sent as the first byte, so broadcasts can be up to MAX_BROADCAST_SIZE bytes.
+    // Only one radio should broadcast to a group since the sequence numbers are tracked per radio.
+    // broadcast           = Sends data to every radio listening to groupId 'copies' times and returns its sequence number.
+    //                       Returns once the copies are in the TX buffer, so several broadcasts are sent back to back.
+    //                       Data longer than MAX_BROADCAST_SIZE bytes is truncated.
+    // rebroadcast         = Sends data again using its original sequence number, e.g. to repair a broadcast some radios
+    //                       missed.  Radios that already received it drop it as a duplicate.  The sequence number must be
+    //                       at most MAX_REBROADCAST_AGE before the newest one, since receivers drop older ones.  Receivers
+    //                       take 2 consecutive older sequence numbers to mean the broadcaster restarted its sequence
+    //                       numbers, and start tracking them again from the second one.  After a restart that lands
+    //                       within MAX_REBROADCAST_AGE of the newest one, broadcasts look like rebroadcasts, and the ones
+    //                       already received are dropped as duplicates until the sequence numbers pass the newest one.
+    // listenForBroadcasts = Must be called before 'init'.  Receives broadcasts to groupId using RX pipe 0, which is
+    //                       otherwise only used to receive ACK packets while transmitting.
+    // readBroadcast       = Use when 'hasData' returns 0.  Loads a new broadcast into the data parameter, which must hold
+    //                       MAX_BROADCAST_SIZE bytes, and returns its length or 0 if there is none.  Duplicates are discarded.
+    //                       ACK data received while transmitting must be read with 'hasAckData' before using 'hasData'.
+    // getMissedBroadcasts = Returns a bitmask of missed broadcasts where bit n is sequence number 'newestSequence' - n.
+    //                       Covers up to 32 sequence numbers, starting from the first broadcast received since the
+    //                       broadcaster started.
+    static const uint8_t MAX_BROADCAST_SIZE = 31; // 1 byte of the 32 byte packet holds the sequence number.
+    static const uint8_t MAX_REBROADCAST_AGE = 15;
+    uint8_t broadcast(uint8_t groupId, void *data, uint8_t length, uint8_t copies = 2);
+    void rebroadcast(uint8_t groupId, uint8_t sequence, void *data, uint8_t length, uint8_t copies = 2);
+    void listenForBroadcasts(uint8_t groupId);
+    uint8_t readBroadcast(void *data, uint8_t &sequence);
+    uint32_t getMissedBroadcasts(uint8_t &newestSequence);
+
+    // Methods for periodic beacons.
+    // A beacon is a NO_ACK packet that is loaded into the radio once and sent again by pulsing CE, using the radio's
+    // REUSE_TX_PL feature, so sending a beacon needs no SPI transactions.  With shared CE and CSN pins CE cannot be
+    // pulsed on its own, so the data is uploaded for every beacon instead.  Any other send, or switching to RX mode,
+    // ends beaconing, and 'startBeacon' must be called again after 'powerDown'.  TX_DS is not cleared after each
+    // beacon, so the IRQ pin stays asserted while beaconing.
+    // startBeacon  = Puts the radio into TX mode and loads the beacon for toRadioId, after any packets already in
+    //                the TX buffer are sent.  The Beacon provided by the calling program holds the state of the beacon,
+    //                so only radios that send beacons use memory for it.  It and the data must remain valid while
+    //                beaconing, since the data is read again when using shared CE and CSN pins.
+    // sendBeacon   = Sends the beacon once without waiting for it to complete.  Does nothing when not beaconing.
+    // updateBeacon = Replaces the beacon data, only needed when the data changes.  Does nothing when not beaconing.
+    struct Beacon { void *Data; uint8_t Length; uint32_t LastMicros; };
+    void startBeacon(Beacon &beacon, uint8_t toRadioId, void *data, uint8_t length);
+    void sendBeacon();
+    void updateBeacon(void *data, uint8_t length);
+
+    // Methods for automatic transmit power control.
+    // setAutoPower  = Starts using the provided array to remember the output power for each destination radio, so only
+    //                 radios that use this feature use memory for it.  'send' lowers the power used for a destination
+    //                 after many packets are sent to it with few retries, and raises it when retries increase or a packet
+    //                 fails to send.  This saves energy and reduces interference for other radios.  Power levels are
+    //                 remembered for the last entryCount radios sent packets requiring an ACK, other destinations use
+    //                 0 dBm, and ACK packets sent to other radios always use 0 dBm.  An entryCount of 0 disables it,
+    //                 which is the default and keeps 0 dBm for everything.
+    // getPowerLevel = Returns the output power used when sending to a radio, without changing the remembered radios.
+    struct PowerEntry { uint8_t RadioId, Level, LowRetryCount, IsUsed; };
+    void setAutoPower(PowerEntry entries[], uint8_t entryCount);
+    PowerLevels getPowerLevel(uint8_t toRadioId);
 
     // Methods for receivers.
-    // hasData     = Puts the radio into RX mode and checks to see if a data packet has been received and returns its length.
-    // addAckData  = Enqueues an acknowledgment data packet (ACK data) for sending back to a transmitter.  Whenever the
-    //               transmitter sends the next data packet, it will get this ACK data packet back as the response.
-    //               The radio will store up to 3 ACK data packets and will not enqueue more if full, so you can clear
-    //               any stale packets using the 'removeExistingAcks' parameter.
-    // discardData = Removes the current received data packet, useful if a packet of an unexpected size is received.
+    // hasData             = Puts the radio into RX mode and checks to see if a data packet has been received and returns its length.
+    //                       With shared CE and CSN pins, checks are skipped and 0 is returned until the radio has had enough
+    //                       time to receive, since checking stops it from receiving.  Packets left in the RX buffer after
+    //                       reading one are checked for right away.
+    // addAckData          = Enqueues an acknowledgment data packet (ACK data) for sending back to a transmitter.  Whenever the
+    //                       transmitter sends the next data packet, it will get this ACK data packet back as the response.
+    //                       The radio will store up to 3 ACK data packets and will not enqueue more if full, so you can clear
+    //                       any stale packets using the 'removeExistingAcks' parameter.
+    // discardData         = Removes the current received data packet, useful if a packet of an unexpected size is received.
+    // microsUntilRxCheck  = Returns how long until 'hasData' will check the radio again, always 0 with separate CE and CSN
+    //                       pins.  Useful to sleep or do other work rather than calling 'hasData' in a tight loop.
+    // setAdaptiveRxWindow = With shared CE and CSN pins, adapts the time between checks to the traffic: it shrinks when
+    //                       several packets are read in a row, so the radio's 3 packet RX buffer doesn't overflow, and grows
+    //                       when checks find nothing.  This saves SPI transactions on lightly loaded receivers in exchange
+    //                       for more latency.  Disabled by default, which keeps the fixed time set for the bitrate.
     uint8_t hasData(uint8_t usingInterrupts = 0);
     void addAckData(void *data, uint8_t length, uint8_t removeExistingAcks = 0);
     void discardData(uint8_t unexpectedDataLength);
+    uint16_t microsUntilRxCheck();
+    void setAdaptiveRxWindow(uint8_t enabled);
 
     // Methods when using the radio's IRQ pin for interrupts.
     // If interrupts are used, do not use the 'send' and 'hasData' functions above and instead use the below functions.
@@ -77,13 +259,100 @@ class NRFLite {
     void startSend(uint8_t toRadioId, void *data, uint8_t length, SendType sendType = REQUIRE_ACK);
     void whatHappened(uint8_t &txOk, uint8_t &txFail, uint8_t &rxReady);
 
+    // Methods for queueing packets to send when using interrupts.
+    // The queue is an array of QueuedPacket provided by the calling program, so it can be much deeper than the radio's
+    // 3 packet TX buffer and packets can be enqueued in bursts without waiting.  Packets are sent in order and at most
+    // 2 are loaded into the radio at a time, so each TX_DS interrupt tells exactly which packets were sent.  Packets to
+    // a different radio are loaded once the previous packets are sent, since the address applies to the whole buffer.
+    // Do not use 'startSend', 'whatHappened', or 'startRx' while 'getQueueCount' is non-zero.
+    // startQueue    = Starts using the provided array for the queue, which holds up to packetCount packets.
+    // enqueue       = Copies a packet into the queue and returns its index in the array, or QUEUE_IS_FULL.  The Status
+    //                 of the packet at that index can be checked until the queue wraps around and reuses it.
+    // serviceQueue  = Use this rather than 'whatHappened' when the IRQ pin is asserted.  Marks sent and failed packets and
+    //                 loads the next ones into the radio.  A failed packet is the only one removed, the packets after it
+    //                 are loaded again.  Returns 1 if ACK data was received, read it with 'hasAckData' and 'readData'
+    //                 before the radio's 3 packet RX buffer fills.  All status flags are cleared to reset the IRQ pin.
+    // getQueueCount = Returns the number of packets waiting or being sent.
+    enum QueueStatuses : uint8_t { QUEUE_WAITING, QUEUE_SENDING, QUEUE_SENT, QUEUE_FAILED };
+    static const uint8_t QUEUE_IS_FULL = 255;
+
+    struct QueuedPacket
+    {
+        uint8_t ToRadioId;
+        SendType Type;
+        QueueStatuses Status;
+        uint8_t Length;
+        uint8_t Data[32];
+    };
+
+    void startQueue(QueuedPacket packets[], uint8_t packetCount);
+    uint8_t enqueue(uint8_t toRadioId, void *data, uint8_t length, SendType sendType = REQUIRE_ACK);
+    uint8_t serviceQueue();
+    uint8_t getQueueCount();
+
+    // Methods for sending to many radios.
+    // sendBatch = Sends every item and waits for them to complete, returning the number that were sent.  Items are sent
+    //             grouped by destination, in the order each destination first appears, so the address written to the
+    //             radio only changes once per destination and the TX buffer stays loaded while sending to it.  The
+    //             Status of each item is set to QUEUE_SENT or QUEUE_FAILED.  Items can be up to 32 bytes.
+    struct BatchItem
+    {
+        uint8_t ToRadioId;
+        void *Data;
+        uint8_t Length;
+        QueueStatuses Status;
+    };
+
+    uint8_t sendBatch(BatchItem items[], uint8_t itemCount, SendType sendType = REQUIRE_ACK);
+
+    // Methods for sending and receiving typed messages.
+    // A message type is a struct containing a 'static const uint8_t MESSAGE_ID' between 0 and MAX_MESSAGE_TYPES - 1.
+    // The id is sent as the first byte of the packet, so a message type can be up to MAX_MESSAGE_SIZE bytes.
+    // send<T>         = Same as 'send' but the packet is tagged with the message id.  Message size is checked at compile-time.
+    // startMessages   = Starts using the provided array to hold the handler for each message id, so only radios that
+    //                   receive messages use memory for them.  Message ids must be less than routeCount.
+    // on<T>           = Registers a function to handle a message type, e.g. 'void handlePacket1(RadioPacket1 &message)'.
+    //                   Must be called after 'startMessages', and ids that don't fit in its array are ignored.
+    // dispatchMessage = Checks for a received message, reads it directly into a message of the registered type, and
+    //                   calls its handler.  Returns 1 if a message was handled.  Messages without a handler or with
+    //                   an unexpected length are discarded.
+    static const uint8_t MAX_MESSAGE_TYPES = 8;
+    static const uint8_t MAX_MESSAGE_SIZE = 31; // 1 byte of the 32 byte packet holds the message id.
+
+    // Each message type has a reader, generated at compile-time by 'on<T>', that finishes reading the packet into
+    // a message of that type and calls the handler.  Readers are stored by message id for constant time dispatch.
+    typedef void (*MessageHandler)();
+    typedef uint8_t (*MessageReader)(NRFLite &radio, MessageHandler handler, uint8_t length);
+    struct MessageRoute { MessageReader Reader; MessageHandler Handler; };
+
+    template<typename T>
+    uint8_t send(uint8_t toRadioId, T &message, SendType sendType = REQUIRE_ACK)
+    {
+        static_assert(sizeof(T) <= MAX_MESSAGE_SIZE, "Message types cannot be larger than 31 bytes.");
+        static_assert(T::MESSAGE_ID < MAX_MESSAGE_TYPES, "Message ids must be less than MAX_MESSAGE_TYPES.");
+        return sendPacket(toRadioId, T::MESSAGE_ID, &message, sizeof(T), sendType);
+    }
+
+    void startMessages(MessageRoute routes[], uint8_t routeCount);
+
+    template<typename T>
+    void on(void (*handler)(T &message))
+    {
+        static_assert(sizeof(T) <= MAX_MESSAGE_SIZE, "Message types cannot be larger than 31 bytes.");
+        static_assert(T::MESSAGE_ID < MAX_MESSAGE_TYPES, "Message ids must be less than MAX_MESSAGE_TYPES.");
+        if (T::MESSAGE_ID >= _messageRouteCount) return;
+        _messageRoutes[T::MESSAGE_ID].Reader = &readMessage<T>;
+        _messageRoutes[T::MESSAGE_ID].Handler = reinterpret_cast<MessageHandler>(handler);
+    }
+
+    uint8_t dispatchMessage();
+
   private:
 
     enum SpiTransferType : uint8_t { READ_OPERATION, WRITE_OPERATION };
 
-    constexpr static uint8_t ADDRESS_PREFIX[4] = { 1, 2, 3, 4 }; // 1st 4 bytes of addresses, 5th byte will be RadioId.
-    static const uint8_t CONFIG_REG_FOR_RX_MODE = _BV(PWR_UP) | _BV(PRIM_RX) | _BV(EN_CRC);
     static const uint8_t POWERDOWN_TO_RXTX_MODE_MILLIS = 5; // 4500uS to Standby + 130uS to RX or TX mode, so 5ms is enough.
+    static const int16_t NO_HEADER = -1; // Packets without a message id or sequence number byte before the data.
 
     Stream *_serial;
     Bitrates _savedBitrate;
@@ -92,20 +361,114 @@ class NRFLite {
     uint8_t _savedChannel, _savedRadioId;
     uint8_t _cePin, _csnPin, _momi_MASK, _sck_MASK, _usingInterrupts, _useTwoPinSpiTransfer, _usingSeparateCeAndCsnPins;
     uint16_t _minRxTimeMicros, _txRetryMicros;
+    uint8_t _retryDelaySteps = 0; // 250 uS steps added to the retry delay set by 'initRadio'.
+    uint16_t _randomState = 0;    // Random numbers used by 'getRandom', 0 until it is first called.
+    uint16_t _rxWindowMicros;     // RX time for shared CE and CSN pin operation, adapted when _usingAdaptiveRxWindow is set.
+    uint32_t _lastRxCheckMicros;
+    uint8_t _rxBurstCount;        // Packets read since the RX buffer was last found empty.
+    uint8_t _usingAdaptiveRxWindow = 0;
+    uint8_t _addressWidth = ADDRESS_WIDTH_5, _staticPayloadLength = 0;
+    uint8_t _configRegForRxMode = _BV(PWR_UP) | _BV(PRIM_RX) | _BV(EN_CRC);
+    uint8_t _addressPrefix[4] = { 1, 2, 3, 4 }; // 1st 4 bytes of addresses, 5th byte will be RadioId.
+
+    // Optional features are called through these function pointers, which are only set while a feature is in use,
+    // so the code of features a sketch never starts isn't linked into it.  Hooks are passed one of the HookEvents, and
+    // 'whatHappened' passes IRQ_HANDLED combined with the TX_DS and RX_DR flags it cleared.
+    enum HookEvents : uint8_t
+    {
+        TX_STARTED, RX_STARTED, SEND_STARTED, RX_FOUND, RX_FOUND_ISR, RX_READ,
+        TX_SENT = _BV(TX_DS), TX_FAILED = _BV(MAX_RT), IRQ_HANDLED = 0x80
+    };
+    typedef void (*Hook)(NRFLite &radio, uint8_t event);
+    typedef void (*TraceRecorder)(NRFLite &radio, uint8_t command, uint8_t status, uint8_t length, uint8_t data);
+    Hook _autoPowerHook = NULL;
+    Hook _beaconHook = NULL;
+    Hook _listenBeforeTalkHook = NULL;
+    Hook _timestampHook = NULL;
+    TraceRecorder _traceRecorder = NULL;
+
+    // Output power for each recent destination.  Levels change by one step at a time, except a failed send
+    // returns straight to 0 dBm so the next packet is likely to get through.
+    static const uint8_t AUTO_POWER_LOW_RETRIES = 0;     // Sends with this many retries or fewer count towards lowering the power.
+    static const uint8_t AUTO_POWER_HIGH_RETRIES = 2;    // Sends with this many retries or more raise the power.
+    static const uint8_t AUTO_POWER_LOWER_AFTER = 16;    // Number of low retry sends in a row needed to lower the power.
+    PowerEntry *_powerEntries;
+    uint8_t _powerEntryCount = 0, _powerEntryToReplace, _powerLevel, _lastSendType;
+
+    // Broadcasts.  Receivers remember which of the last 32 sequence numbers they received in order to drop duplicates.
+    uint8_t _isListeningForBroadcasts = 0, _broadcastGroupId, _txToGroup = 0, _nextBroadcastSequence = 0;
+    uint8_t _trackedBroadcasts = 0, _newestBroadcastSequence; // Tracked is the number of sequence numbers since the first broadcast, up to 32.
+    uint8_t _oldBroadcastSequence; // Last sequence number older than MAX_REBROADCAST_AGE, or the newest one.
+    uint32_t _receivedBroadcasts; // Bit n is set if sequence number _newestBroadcastSequence - n was received.
+
+    // Beacons.  The data is only read when loading it into the radio, or for every beacon with shared CE and CSN pins.
+    Beacon *_beacon;
     volatile uint8_t *_momi_DDR, *_momi_PORT, *_momi_PIN, *_sck_PORT;
 
+    // Message handlers, in the array provided to 'startMessages'.
+    MessageRoute *_messageRoutes;
+    uint8_t _messageRouteCount = 0;
+
+    template<typename T>
+    static uint8_t readMessage(NRFLite &radio, MessageHandler handler, uint8_t length)
+    {
+        T message;
+        uint8_t isExpectedLength = radio.endMessageRead(&message, sizeof(T), length);
+        if (isExpectedLength) reinterpret_cast<void (*)(T &)>(handler)(message);
+        return isExpectedLength;
+    }
+
+    uint8_t endMessageRead(void *data, uint8_t messageLength, uint8_t length);
+
+    // Packet queue.  The oldest packet that is not yet sent is at _queueFirst, and the first _queueLoadedCount
+    // packets starting there are in the radio's TX buffer.
+    static const uint8_t MAX_LOADED_QUEUE_PACKETS = 2;
+    QueuedPacket *_queue;
+    uint8_t _queueSize = 0, _queueFirst, _queueCount = 0, _queueLoadedCount;
+
+    TraceEntry *_traceEntries;
+    uint8_t _traceEntryCount = 0, _traceIndex, _traceIsFull;
+
+    Timestamps *_timestamps;
+
+    uint8_t clearStatusFlags(uint8_t flags);
+    uint8_t completeBatchItems(BatchItem items[], uint8_t loaded[], uint8_t &loadedCount, SendType sendType);
+    void completeQueuedPacket(QueueStatuses status);
+    static void adjustPower(NRFLite &radio, uint8_t event);
+    static void endBeacon(NRFLite &radio, uint8_t event);
+    PowerEntry *findPowerEntry(uint8_t radioId);
+    PowerEntry &getPowerEntry(uint8_t radioId);
+    uint16_t getRandom(uint16_t limit);
     uint8_t getPipeOfFirstRxPacket();
     uint8_t getRxPacketLength();
     uint8_t initRadio(uint8_t radioId, Bitrates bitrate, uint8_t channel);
-    void printRegister(const char name[], uint8_t regName);
-    void startTx(uint8_t toRadioId, SendType sendType);
+    uint8_t isNewBroadcast(uint8_t sequence);
+    void loadBeacon();
+    void loadQueue();
+    static void printAddress(Print &output, const __FlashStringHelper *name, const uint8_t address[5]);
+    static void printRegister(Print &output, const __FlashStringHelper *name, uint8_t reg);
+    static void recordTimestamp(NRFLite &radio, uint8_t event);
+    static void recordTrace(NRFLite &radio, uint8_t command, uint8_t status, uint8_t length, uint8_t data);
+    void sendBroadcast(uint8_t groupId, uint8_t sequence, void *data, uint8_t length, uint8_t copies);
+    uint8_t sendPacket(uint8_t toRadioId, int16_t header, void *data, uint8_t length, SendType sendType);
+    void setPowerLevel(uint8_t level);
+    void setRetryDelay(uint8_t extraSteps);
+    void startTx(uint8_t toRadioId, SendType sendType, uint8_t toGroup = 0);
+    void updatePowerLevel(uint8_t packetWasSent);
+    void updateRxWindow();
+    static void waitForClearChannel(NRFLite &radio, uint8_t event);
     uint8_t waitForTx(uint8_t usingInterrupts);
+    void writeAddress(uint8_t regName, uint8_t radioId, uint8_t isGroupAddress = 0);
+    void writeTxPayload(SendType sendType, void *data, uint8_t length, int16_t header = NO_HEADER);
 
     uint8_t readRegister(uint8_t regName);
-    void readRegister(uint8_t regName, void* data, uint8_t length);
+    uint8_t readRegister(uint8_t regName, void* data, uint8_t length);
     void writeRegister(uint8_t regName, uint8_t data);
     void writeRegister(uint8_t regName, void* data, uint8_t length);
-    void spiTransfer(SpiTransferType transferType, uint8_t regName, void* data, uint8_t length);
+    uint8_t spiTransfer(SpiTransferType transferType, uint8_t regName, void* data, uint8_t length);
+    void spiBegin();
+    uint8_t spiTransferByte(uint8_t data);
+    void spiEnd();
 
 #if defined(__AVR_ATtiny45__) || defined(__AVR_ATtiny85__) || defined(__AVR_ATtiny44__) || defined(__AVR_ATtiny84__)
     uint8_t usiTransfer(uint8_t data);